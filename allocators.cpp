@@ -0,0 +1,63 @@
+#include "allocators.h"
+#include "constants.h"
+#include <iostream>
+
+// Initialize static instance to nullptr
+FrameArena* FrameArena::instance = nullptr;
+
+FrameArena* FrameArena::Instance() {
+    // Create instance if it doesn't exist
+    if (instance == nullptr) {
+        instance = new FrameArena();
+    }
+    return instance;
+}
+
+FrameArena::FrameArena()
+    : buffer(FRAME_ARENA_BYTES),
+      offset(0),
+      highWater(0),
+      overflowReported(false) {
+}
+
+void* FrameArena::allocate(size_t bytes, size_t alignment) {
+    size_t start = (offset + alignment - 1) / alignment * alignment;
+    if (start + bytes > buffer.size()) {
+        if (!overflowReported) {
+            std::cerr << "Frame arena out of space: " << bytes << " bytes requested, "
+                      << buffer.size() - offset << " free" << std::endl;
+            overflowReported = true;
+        }
+        return nullptr;
+    }
+
+    offset = start + bytes;
+    if (offset > highWater) {
+        highWater = offset;
+    }
+    return buffer.data() + start;
+}
+
+size_t FrameArena::mark() const {
+    return offset;
+}
+
+void FrameArena::rewind(size_t marker) {
+    if (marker < offset) {
+        offset = marker;
+    }
+}
+
+void FrameArena::reset() {
+    offset = 0;
+}
+
+AllocatorStats FrameArena::getStats() const {
+    return {offset, highWater, buffer.size()};
+}
+
+void FrameArena::clean() {
+    // Clean up the instance
+    delete instance;
+    instance = nullptr;
+}
@@ -0,0 +1,135 @@
+#ifndef ALLOCATORS_H
+#define ALLOCATORS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Usage of a pool (in objects) or an arena (in bytes)
+struct AllocatorStats {
+    size_t used;
+    size_t highWater;       // Most ever used at once
+    size_t capacity;
+};
+
+// Fixed number of same-sized blocks carved out of one allocation. create() and
+// destroy() are O(1) and never touch the heap, so objects that come and go every
+// few frames (map cells) neither allocate nor fragment memory.
+template <typename T>
+class Pool {
+private:
+    struct alignas(T) Block {
+        unsigned char bytes[sizeof(T)];
+    };
+
+    std::vector<Block> blocks;
+    std::vector<uint32_t> freeBlocks;   // Indices of unused blocks, used as a stack
+    std::vector<uint8_t> live;
+    size_t highWater;
+
+public:
+    explicit Pool(size_t capacity)
+        : blocks(capacity), live(capacity, 0), highWater(0) {
+        freeBlocks.reserve(capacity);
+        // Hand out low indices first so live objects stay packed together
+        for (size_t i = capacity; i > 0; --i) {
+            freeBlocks.push_back(static_cast<uint32_t>(i - 1));
+        }
+    }
+
+    ~Pool() {
+        clear();
+    }
+
+    Pool(const Pool&) = delete;
+    Pool& operator=(const Pool&) = delete;
+
+    // Construct a T in a free block; nullptr when the pool is full
+    template <typename... Args>
+    T* create(Args&&... args) {
+        if (freeBlocks.empty()) {
+            return nullptr;
+        }
+        uint32_t index = freeBlocks.back();
+        freeBlocks.pop_back();
+        T* object = new (blocks[index].bytes) T(std::forward<Args>(args)...);
+        live[index] = 1;
+        size_t used = blocks.size() - freeBlocks.size();
+        if (used > highWater) {
+            highWater = used;
+        }
+        return object;
+    }
+
+    // Destroy an object made by create() and return its block
+    void destroy(T* object) {
+        if (object == nullptr) {
+            return;
+        }
+        uint32_t index = static_cast<uint32_t>(reinterpret_cast<Block*>(object) - blocks.data());
+        object->~T();
+        live[index] = 0;
+        freeBlocks.push_back(index);
+    }
+
+    // Destroy every live object
+    void clear() {
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            if (live[i]) {
+                destroy(reinterpret_cast<T*>(blocks[i].bytes));
+            }
+        }
+    }
+
+    AllocatorStats getStats() const {
+        return {blocks.size() - freeBlocks.size(), highWater, blocks.size()};
+    }
+};
+
+// Linear allocator for data that only lives for one frame (render command lists,
+// scratch buffers). Allocation bumps an offset; reset() frees everything at once.
+// Callers that finish early can hand their space back with mark()/rewind().
+// Not thread-safe: allocate on the main thread, though jobs may fill the memory.
+class FrameArena {
+private:
+    static FrameArena* instance;
+
+    std::vector<unsigned char> buffer;
+    size_t offset;
+    size_t highWater;
+    bool overflowReported;
+
+    FrameArena();
+
+public:
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // Get singleton instance
+    static FrameArena* Instance();
+
+    // Aligned block of bytes, or nullptr if the arena is full
+    void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+    // Uninitialized array of count T; T must be trivially destructible
+    template <typename T>
+    T* allocateArray(size_t count) {
+        return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    size_t mark() const;
+    void rewind(size_t marker);
+    void reset();
+
+    AllocatorStats getStats() const;
+
+    // Release the buffer
+    void clean();
+};
+
+// Shorthand for accessing the frame arena
+typedef FrameArena TheFrameArena;
+
+#endif // ALLOCATORS_H
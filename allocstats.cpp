@@ -0,0 +1,65 @@
+#include "allocstats.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef TRACK_ALLOCATIONS
+
+static std::atomic<uint64_t> allocationCount(0);
+static std::atomic<uint64_t> allocationBytes(0);
+
+// Every other operator new form in the standard library forwards to these
+void* operator new(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocationBytes.fetch_add(size, std::memory_order_relaxed);
+    void* memory = std::malloc(size ? size : 1);
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+AllocationCounts getAllocationCounts() {
+    return {allocationCount.load(std::memory_order_relaxed), allocationBytes.load(std::memory_order_relaxed)};
+}
+
+bool isAllocationTrackingEnabled() {
+    return true;
+}
+
+#else
+
+AllocationCounts getAllocationCounts() {
+    return {0, 0};
+}
+
+bool isAllocationTrackingEnabled() {
+    return false;
+}
+
+#endif
+
+AllocationCounts allocationsSince(const AllocationCounts& start) {
+    AllocationCounts now = getAllocationCounts();
+    return {now.count - start.count, now.bytes - start.bytes};
+}
@@ -0,0 +1,23 @@
+#ifndef ALLOCSTATS_H
+#define ALLOCSTATS_H
+
+#include <cstdint>
+
+// Heap allocations made through operator new, counted over all threads.
+// Counting is compiled in only when building with -DTRACK_ALLOCATIONS ("make debug");
+// otherwise the counters stay at zero and operator new is untouched.
+struct AllocationCounts {
+    uint64_t count;
+    uint64_t bytes;
+};
+
+// Allocations made since the program started
+AllocationCounts getAllocationCounts();
+
+// Difference between two getAllocationCounts() snapshots
+AllocationCounts allocationsSince(const AllocationCounts& start);
+
+// Whether this build counts allocations
+bool isAllocationTrackingEnabled();
+
+#endif // ALLOCSTATS_H
@@ -0,0 +1,262 @@
+#include "assetpack.h"
+#include <SDL2/SDL_image.h>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Whether an entry's name, data range and (for images) pixel layout can be trusted.
+// A truncated or stale pack must not make texture creation read past the mapping.
+static bool isEntryUsable(const PackEntry& entry, size_t packSize) {
+    if (std::memchr(entry.name, '\0', ASSET_PACK_NAME_LENGTH) == nullptr ||
+        entry.offset > packSize || entry.size > packSize - entry.offset) {
+        return false;
+    }
+    if (entry.type != PackEntryType::IMAGE) {
+        return true;
+    }
+    return entry.pixelFormat == ASSET_PACK_PIXEL_FORMAT && entry.width > 0 && entry.height > 0 &&
+           entry.pitch >= static_cast<uint64_t>(entry.width) * 4 &&
+           static_cast<uint64_t>(entry.pitch) * entry.height <= entry.size;
+}
+
+AssetPack::AssetPack()
+    : data(nullptr),
+      size(0),
+      entries(nullptr),
+      entryCount(0),
+#ifdef _WIN32
+      fileHandle(nullptr),
+      mappingHandle(nullptr)
+#else
+      fileDescriptor(-1)
+#endif
+{}
+
+AssetPack::~AssetPack() {
+    close();
+}
+
+bool AssetPack::open(const std::string& path) {
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        CloseHandle(file);
+        return false;
+    }
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    fileHandle = file;
+    mappingHandle = mapping;
+    data = static_cast<const uint8_t*>(view);
+    size = static_cast<size_t>(fileSize.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (view == MAP_FAILED) {
+        ::close(fd);
+        return false;
+    }
+    fileDescriptor = fd;
+    data = static_cast<const uint8_t*>(view);
+    size = static_cast<size_t>(info.st_size);
+#endif
+
+    // Validate the header and table before trusting any offsets
+    const PackHeader* header = reinterpret_cast<const PackHeader*>(data);
+    if (size < sizeof(PackHeader) || header->magic != ASSET_PACK_MAGIC || header->version != ASSET_PACK_VERSION ||
+        size < sizeof(PackHeader) + static_cast<size_t>(header->entryCount) * sizeof(PackEntry)) {
+        std::cerr << "Invalid asset pack: " << path << std::endl;
+        close();
+        return false;
+    }
+    entries = reinterpret_cast<const PackEntry*>(data + sizeof(PackHeader));
+    entryCount = header->entryCount;
+    usable.assign(entryCount, 0);
+    int rejected = 0;
+    for (uint32_t i = 0; i < entryCount; ++i) {
+        usable[i] = isEntryUsable(entries[i], size) ? 1 : 0;
+        rejected += usable[i] ? 0 : 1;
+    }
+    if (rejected > 0) {
+        std::cerr << "Asset pack " << path << ": ignoring " << rejected
+                  << " damaged entries, their files will be decoded instead" << std::endl;
+    }
+
+    return true;
+}
+
+void AssetPack::close() {
+    if (data == nullptr) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+    CloseHandle(static_cast<HANDLE>(mappingHandle));
+    CloseHandle(static_cast<HANDLE>(fileHandle));
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+#else
+    munmap(const_cast<uint8_t*>(data), size);
+    ::close(fileDescriptor);
+    fileDescriptor = -1;
+#endif
+    data = nullptr;
+    size = 0;
+    entries = nullptr;
+    entryCount = 0;
+    usable.clear();
+}
+
+bool AssetPack::isOpen() const {
+    return data != nullptr;
+}
+
+const PackEntry* AssetPack::find(const std::string& name) const {
+    for (uint32_t i = 0; i < entryCount; ++i) {
+        if (usable[i] && std::strncmp(entries[i].name, name.c_str(), ASSET_PACK_NAME_LENGTH) == 0) {
+            return &entries[i];
+        }
+    }
+    return nullptr;
+}
+
+const void* AssetPack::getData(const PackEntry& entry) const {
+    return data + entry.offset;
+}
+
+// Round up to the next data alignment boundary
+static uint64_t alignOffset(uint64_t offset) {
+    return (offset + ASSET_PACK_ALIGNMENT - 1) / ASSET_PACK_ALIGNMENT * ASSET_PACK_ALIGNMENT;
+}
+
+bool writeAssetPack(const std::string& path, const std::vector<PackSource>& sources) {
+    std::vector<PackEntry> entries;
+    std::vector<std::vector<uint8_t>> blobs;
+
+    for (const PackSource& source : sources) {
+        if (source.path.size() >= ASSET_PACK_NAME_LENGTH) {
+            std::cerr << "Asset path too long for pack: " << source.path << std::endl;
+            return false;
+        }
+
+        PackEntry entry = {};
+        std::strncpy(entry.name, source.path.c_str(), ASSET_PACK_NAME_LENGTH - 1);
+        entry.type = source.type;
+        std::vector<uint8_t> blob;
+
+        if (source.type == PackEntryType::IMAGE) {
+            SDL_Surface* loaded = IMG_Load(source.path.c_str());
+            if (loaded == nullptr) {
+                std::cerr << "Failed to load texture file: " << source.path
+                          << " Error: " << IMG_GetError() << std::endl;
+                return false;
+            }
+            SDL_Surface* converted = SDL_ConvertSurfaceFormat(loaded, ASSET_PACK_PIXEL_FORMAT, 0);
+            SDL_FreeSurface(loaded);
+            if (converted == nullptr) {
+                std::cerr << "Failed to convert " << source.path << ". SDL Error: " << SDL_GetError() << std::endl;
+                return false;
+            }
+
+            entry.pixelFormat = ASSET_PACK_PIXEL_FORMAT;
+            entry.width = converted->w;
+            entry.height = converted->h;
+            entry.pitch = converted->w * 4;
+            entry.frameWidth = source.frameWidth;
+            entry.frameHeight = source.frameHeight;
+
+            // Tightly packed rows; note whether blending will be needed
+            blob.resize(static_cast<size_t>(entry.pitch) * entry.height);
+            SDL_LockSurface(converted);
+            for (int y = 0; y < converted->h; ++y) {
+                const Uint8* row = static_cast<const Uint8*>(converted->pixels) + y * converted->pitch;
+                std::memcpy(&blob[static_cast<size_t>(y) * entry.pitch], row, entry.pitch);
+                const Uint32* pixels = reinterpret_cast<const Uint32*>(row);
+                for (int x = 0; x < converted->w && !(entry.flags & PACK_ENTRY_HAS_ALPHA); ++x) {
+                    if ((pixels[x] >> 24) != 0xFF) {
+                        entry.flags |= PACK_ENTRY_HAS_ALPHA;
+                    }
+                }
+            }
+            SDL_UnlockSurface(converted);
+            SDL_FreeSurface(converted);
+        } else {
+            std::ifstream file(source.path, std::ios::binary);
+            if (!file) {
+                std::cerr << "Failed to read asset file: " << source.path << std::endl;
+                return false;
+            }
+            blob.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+
+        entry.size = blob.size();
+        entries.push_back(entry);
+        blobs.push_back(std::move(blob));
+    }
+
+    // Lay out data after the header and entry table
+    uint64_t offset = sizeof(PackHeader) + entries.size() * sizeof(PackEntry);
+    for (PackEntry& entry : entries) {
+        offset = alignOffset(offset);
+        entry.offset = offset;
+        offset += entry.size;
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Failed to create asset pack: " << path << std::endl;
+        return false;
+    }
+
+    PackHeader header = {ASSET_PACK_MAGIC, ASSET_PACK_VERSION, static_cast<uint32_t>(entries.size()), 0};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(PackEntry));
+
+    uint64_t written = sizeof(PackHeader) + entries.size() * sizeof(PackEntry);
+    static const char padding[ASSET_PACK_ALIGNMENT] = {};
+    for (size_t i = 0; i < entries.size(); ++i) {
+        out.write(padding, static_cast<std::streamsize>(entries[i].offset - written));
+        out.write(reinterpret_cast<const char*>(blobs[i].data()), static_cast<std::streamsize>(blobs[i].size()));
+        written = entries[i].offset + entries[i].size;
+    }
+
+    if (!out) {
+        std::cerr << "Failed to write asset pack: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
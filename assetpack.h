@@ -0,0 +1,94 @@
+#ifndef ASSETPACK_H
+#define ASSETPACK_H
+
+#include <SDL2/SDL.h>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Asset pack layout (native byte order):
+//   PackHeader
+//   PackEntry[entryCount]
+//   entry data, each starting on an ASSET_PACK_ALIGNMENT boundary
+// Images are stored fully decoded in ASSET_PACK_PIXEL_FORMAT with rows `pitch`
+// bytes apart, so textures can be filled straight from the mapped file.
+const uint32_t ASSET_PACK_MAGIC             = 0x4B504B42; // "BKPK"
+const uint32_t ASSET_PACK_VERSION           = 1;
+const uint32_t ASSET_PACK_PIXEL_FORMAT      = SDL_PIXELFORMAT_ARGB8888;
+const int ASSET_PACK_NAME_LENGTH            = 64;
+const int ASSET_PACK_ALIGNMENT              = 64;
+
+enum class PackEntryType : uint32_t {
+    IMAGE = 1,
+    FILE = 2        // Raw bytes, e.g. a font
+};
+
+const uint32_t PACK_ENTRY_HAS_ALPHA         = 1; // Image has non-opaque pixels
+
+struct PackHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t reserved;
+};
+
+struct PackEntry {
+    char name[ASSET_PACK_NAME_LENGTH];  // Source path, e.g. "assets/player2.png"
+    PackEntryType type;
+    uint32_t flags;
+    uint32_t pixelFormat;
+    uint32_t width;
+    uint32_t height;
+    uint32_t pitch;
+    uint32_t frameWidth;                // Sprite sheet frame size, 0 if not a sheet
+    uint32_t frameHeight;
+    uint64_t offset;                    // From the start of the file
+    uint64_t size;
+};
+
+// What to put in a pack when building one
+struct PackSource {
+    std::string path;
+    PackEntryType type;
+    int frameWidth;
+    int frameHeight;
+};
+
+// Read-only, memory-mapped view of an asset pack. Entry data points into the mapping
+// and stays valid until close().
+class AssetPack {
+private:
+    const uint8_t* data;
+    size_t size;
+    const PackEntry* entries;
+    uint32_t entryCount;
+    std::vector<uint8_t> usable;    // Per entry: passed the checks in open(); find() skips the rest
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#else
+    int fileDescriptor;
+#endif
+
+public:
+    AssetPack();
+    ~AssetPack();
+
+    AssetPack(const AssetPack&) = delete;
+    AssetPack& operator=(const AssetPack&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const;
+
+    // Entry stored under name (its source path), or nullptr if there is none or it was
+    // rejected when the pack was opened, so the caller decodes the file instead
+    const PackEntry* find(const std::string& name) const;
+    const void* getData(const PackEntry& entry) const;
+};
+
+// Decode every source and write them into a pack at path
+bool writeAssetPack(const std::string& path, const std::vector<PackSource>& sources);
+
+#endif // ASSETPACK_H
@@ -0,0 +1,363 @@
+#include "audio.h"
+#include "constants.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+// Initialize static instance to nullptr
+AudioMixer* AudioMixer::instance = nullptr;
+
+namespace {
+
+const float PI = 3.14159265f;
+
+float noteFrequency(int midiNote) {
+    return 440.0f * std::pow(2.0f, (midiNote - 69) / 12.0f);
+}
+
+// Append a tone with a fast attack and exponential decay; square mixes in odd harmonics
+void appendTone(std::vector<float>& clip, float frequency, float seconds, float volume, float decay, bool square) {
+    int count = static_cast<int>(seconds * AUDIO_FREQUENCY);
+    int attack = AUDIO_FREQUENCY / 500;
+    float phase = 0.0f;
+    float step = 2.0f * PI * frequency / AUDIO_FREQUENCY;
+    for (int i = 0; i < count; ++i) {
+        float envelope = std::exp(-decay * i / AUDIO_FREQUENCY);
+        if (i < attack) {
+            envelope *= static_cast<float>(i) / attack;
+        }
+        float sample = std::sin(phase);
+        if (square) {
+            sample += std::sin(3.0f * phase) / 3.0f + std::sin(5.0f * phase) / 5.0f;
+        }
+        clip.push_back(sample * envelope * volume);
+        phase += step;
+    }
+}
+
+}
+
+AudioMixer* AudioMixer::Instance() {
+    // Create instance if it doesn't exist
+    if (instance == nullptr) {
+        instance = new AudioMixer();
+    }
+    return instance;
+}
+
+AudioMixer::AudioMixer()
+    : commandHead(0),
+      commandTail(0),
+      musicPosition(0),
+      musicPlaying(false),
+      soundPlaying(true),
+      device(0),
+      bufferMs(0.0),
+      soundEnabled(true),
+      droppedCommands(0),
+      latencyCount(0),
+      latencyTotalMicros(0),
+      latencyLastMicros(0),
+      latencyMaxMicros(0) {
+    for (Voice& voice : voices) {
+        voice = Voice{nullptr, 0, 0, 0.0f};
+    }
+}
+
+bool AudioMixer::init(const char* driverName) {
+    if (device != 0) {
+        return true;
+    }
+
+    if (driverName != nullptr) {
+        SDL_setenv("SDL_AUDIODRIVER", driverName, 1);
+    }
+    if (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0) {
+        std::cerr << "Audio could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
+        return false;
+    }
+
+    // Decode everything up front; the callback must never touch the disk or allocate
+    const std::string soundPaths[] = {COIN_SOUND_PATH, CRASH_SOUND_PATH, FINISH_SOUND_PATH};
+    synthesizeClips();
+    for (int i = 0; i < static_cast<int>(SoundID::COUNT); ++i) {
+        loadClip(soundPaths[i], clips[i]);
+    }
+    loadClip(MUSIC_PATH, music);
+
+    // A short buffer in the mixer's own format; SDL converts if the hardware differs
+    SDL_AudioSpec desired = {};
+    desired.freq = AUDIO_FREQUENCY;
+    desired.format = AUDIO_F32SYS;
+    desired.channels = 2;
+    desired.samples = AUDIO_BUFFER_SAMPLES;
+    desired.callback = &AudioMixer::audioCallback;
+    desired.userdata = this;
+
+    SDL_AudioSpec obtained = {};
+    device = SDL_OpenAudioDevice(nullptr, 0, &desired, &obtained, 0);
+    if (device == 0) {
+        std::cerr << "Audio device could not be opened! SDL_Error: " << SDL_GetError() << std::endl;
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        return false;
+    }
+    bufferMs = obtained.samples * 1000.0 / obtained.freq;
+
+    std::cout << "Audio driver " << SDL_GetCurrentAudioDriver() << ", " << obtained.samples
+              << " sample buffer (" << bufferMs << " ms)" << std::endl;
+
+    SDL_PauseAudioDevice(device, 0);
+    return true;
+}
+
+bool AudioMixer::loadClip(const std::string& fileName, std::vector<float>& clip) {
+    SDL_AudioSpec spec;
+    Uint8* buffer = nullptr;
+    Uint32 length = 0;
+    if (SDL_LoadWAV(fileName.c_str(), &spec, &buffer, &length) == nullptr) {
+        // No file means the synthesized clip is kept
+        return false;
+    }
+
+    SDL_AudioCVT convert;
+    if (SDL_BuildAudioCVT(&convert, spec.format, spec.channels, spec.freq, AUDIO_F32SYS, 1, AUDIO_FREQUENCY) < 0) {
+        std::cerr << "Unsupported sound format in " << fileName << ": " << SDL_GetError() << std::endl;
+        SDL_FreeWAV(buffer);
+        return false;
+    }
+
+    std::vector<Uint8> converted(static_cast<size_t>(length) * (convert.len_mult > 0 ? convert.len_mult : 1));
+    std::copy(buffer, buffer + length, converted.begin());
+    SDL_FreeWAV(buffer);
+    convert.buf = converted.data();
+    convert.len = static_cast<int>(length);
+    if (convert.needed && SDL_ConvertAudio(&convert) < 0) {
+        std::cerr << "Failed to convert " << fileName << ": " << SDL_GetError() << std::endl;
+        return false;
+    }
+
+    int convertedBytes = convert.needed ? convert.len_cvt : static_cast<int>(length);
+    const float* samples = reinterpret_cast<const float*>(converted.data());
+    clip.assign(samples, samples + convertedBytes / sizeof(float));
+    return true;
+}
+
+void AudioMixer::synthesizeClips() {
+    for (std::vector<float>& clip : clips) {
+        clip.clear();
+    }
+
+    std::vector<float>& coin = clips[static_cast<int>(SoundID::COIN)];
+    appendTone(coin, noteFrequency(83), 0.05f, 0.35f, 8.0f, true);
+    appendTone(coin, noteFrequency(88), 0.18f, 0.35f, 14.0f, true);
+
+    // Noise burst over a falling thump
+    std::vector<float>& crash = clips[static_cast<int>(SoundID::CRASH)];
+    int crashLength = AUDIO_FREQUENCY * 6 / 10;
+    uint32_t noise = 0x12345678u;
+    float filtered = 0.0f;
+    float phase = 0.0f;
+    crash.resize(crashLength);
+    for (int i = 0; i < crashLength; ++i) {
+        float t = static_cast<float>(i) / AUDIO_FREQUENCY;
+        noise = noise * 1664525u + 1013904223u;
+        float white = static_cast<float>(noise >> 8) / 8388608.0f - 1.0f;
+        filtered += (white - filtered) * 0.3f;
+        phase += 2.0f * PI * (120.0f - 80.0f * t) / AUDIO_FREQUENCY;
+        crash[i] = (filtered * 0.6f * std::exp(-6.0f * t) + std::sin(phase) * 0.5f * std::exp(-4.0f * t));
+    }
+
+    // Rising arpeggio
+    std::vector<float>& finish = clips[static_cast<int>(SoundID::FINISH)];
+    const int finishNotes[] = {72, 76, 79, 84};
+    for (int note : finishNotes) {
+        appendTone(finish, noteFrequency(note), 0.14f, 0.3f, 6.0f, true);
+    }
+    appendTone(finish, noteFrequency(88), 0.5f, 0.3f, 4.0f, true);
+
+    // Eight bars of a soft melody over a bass line, looped by the mixer
+    const int melody[] = {69, 72, 76, 72, 74, 77, 81, 77, 72, 76, 79, 76, 71, 74, 79, 74};
+    const int bass[] = {45, 50, 48, 43};
+    float noteSeconds = 0.25f;
+    int noteLength = static_cast<int>(noteSeconds * AUDIO_FREQUENCY);
+    int melodyCount = static_cast<int>(sizeof(melody) / sizeof(melody[0]));
+    music.assign(static_cast<size_t>(noteLength) * melodyCount * 2, 0.0f);
+    for (int i = 0; i < melodyCount * 2; ++i) {
+        std::vector<float> note;
+        appendTone(note, noteFrequency(melody[i % melodyCount]), noteSeconds, 0.25f, 5.0f, false);
+        for (int s = 0; s < static_cast<int>(note.size()) && s < noteLength; ++s) {
+            music[i * noteLength + s] += note[s];
+        }
+    }
+    int barLength = noteLength * 4;
+    for (int bar = 0; bar < melodyCount * 2 / 4; ++bar) {
+        std::vector<float> note;
+        appendTone(note, noteFrequency(bass[bar % 4]), noteSeconds * 4, 0.3f, 1.0f, false);
+        for (int s = 0; s < static_cast<int>(note.size()) && s < barLength; ++s) {
+            music[bar * barLength + s] += note[s];
+        }
+    }
+}
+
+bool AudioMixer::pushCommand(const Command& command) {
+    uint32_t head = commandHead.load(std::memory_order_relaxed);
+    if (head - commandTail.load(std::memory_order_acquire) >= AUDIO_COMMAND_QUEUE_SIZE) {
+        // The callback is stalled; dropping a sound beats blocking the frame
+        ++droppedCommands;
+        return false;
+    }
+    commands[head % AUDIO_COMMAND_QUEUE_SIZE] = command;
+    commandHead.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+void AudioMixer::playSound(SoundID sound, float volume) {
+    if (device == 0 || !soundEnabled) {
+        return;
+    }
+    pushCommand(Command{CommandType::PLAY_SOUND, static_cast<int>(sound), volume, true, SDL_GetPerformanceCounter()});
+}
+
+void AudioMixer::setMusicEnabled(bool enabled) {
+    if (device == 0) {
+        return;
+    }
+    pushCommand(Command{CommandType::SET_MUSIC, 0, 0.0f, enabled, SDL_GetPerformanceCounter()});
+}
+
+void AudioMixer::setSoundEnabled(bool enabled) {
+    soundEnabled = enabled;
+    if (device == 0) {
+        return;
+    }
+    pushCommand(Command{CommandType::SET_SOUND, 0, 0.0f, enabled, SDL_GetPerformanceCounter()});
+}
+
+void AudioMixer::audioCallback(void* userdata, Uint8* stream, int length) {
+    AudioMixer* mixer = static_cast<AudioMixer*>(userdata);
+    mixer->mix(reinterpret_cast<float*>(stream), length / static_cast<int>(2 * sizeof(float)));
+}
+
+void AudioMixer::runCommands(Uint64 now) {
+    uint32_t tail = commandTail.load(std::memory_order_relaxed);
+    uint32_t head = commandHead.load(std::memory_order_acquire);
+    for (; tail != head; ++tail) {
+        const Command& command = commands[tail % AUDIO_COMMAND_QUEUE_SIZE];
+        switch (command.type) {
+            case CommandType::PLAY_SOUND: {
+                if (!soundPlaying) {
+                    break;
+                }
+                // Take a free voice, or the one closest to finishing
+                Voice* target = &voices[0];
+                for (Voice& voice : voices) {
+                    if (voice.samples == nullptr) {
+                        target = &voice;
+                        break;
+                    }
+                    if (voice.length - voice.position < target->length - target->position) {
+                        target = &voice;
+                    }
+                }
+                const std::vector<float>& clip = clips[command.sound];
+                *target = Voice{clip.data(), static_cast<int>(clip.size()), 0, command.volume};
+                recordLatency(command.issued, now);
+                break;
+            }
+            case CommandType::SET_MUSIC:
+                musicPlaying = command.enabled;
+                break;
+            case CommandType::SET_SOUND:
+                soundPlaying = command.enabled;
+                if (!soundPlaying) {
+                    for (Voice& voice : voices) {
+                        voice.samples = nullptr;
+                    }
+                }
+                break;
+        }
+    }
+    commandTail.store(tail, std::memory_order_release);
+}
+
+void AudioMixer::recordLatency(Uint64 issued, Uint64 now) {
+    // The sound starts at the front of this buffer, which plays once the one before it has
+    uint64_t waitMicros = (now - issued) * 1000000 / SDL_GetPerformanceFrequency();
+    uint64_t micros = waitMicros + static_cast<uint64_t>(bufferMs * 1000.0);
+
+    latencyLastMicros.store(micros, std::memory_order_relaxed);
+    latencyTotalMicros.fetch_add(micros, std::memory_order_relaxed);
+    if (micros > latencyMaxMicros.load(std::memory_order_relaxed)) {
+        latencyMaxMicros.store(micros, std::memory_order_relaxed);
+    }
+    latencyCount.fetch_add(1, std::memory_order_release);
+}
+
+void AudioMixer::mix(float* output, int frames) {
+    runCommands(SDL_GetPerformanceCounter());
+    std::fill(output, output + frames * 2, 0.0f);
+
+    if (musicPlaying && !music.empty()) {
+        int musicLength = static_cast<int>(music.size());
+        for (int i = 0; i < frames; ++i) {
+            float sample = music[musicPosition] * AUDIO_MUSIC_VOLUME;
+            output[2 * i] += sample;
+            output[2 * i + 1] += sample;
+            if (++musicPosition == musicLength) {
+                musicPosition = 0;
+            }
+        }
+    }
+
+    for (Voice& voice : voices) {
+        if (voice.samples == nullptr) {
+            continue;
+        }
+        int count = std::min(frames, voice.length - voice.position);
+        const float* samples = voice.samples + voice.position;
+        for (int i = 0; i < count; ++i) {
+            float sample = samples[i] * voice.volume;
+            output[2 * i] += sample;
+            output[2 * i + 1] += sample;
+        }
+        voice.position += count;
+        if (voice.position >= voice.length) {
+            voice.samples = nullptr;
+        }
+    }
+
+    for (int i = 0; i < frames * 2; ++i) {
+        output[i] = std::max(-1.0f, std::min(1.0f, output[i]));
+    }
+}
+
+bool AudioMixer::isOpen() const {
+    return device != 0;
+}
+
+AudioLatencyStats AudioMixer::getLatencyStats() const {
+    AudioLatencyStats stats = {};
+    stats.sounds = latencyCount.load(std::memory_order_acquire);
+    stats.lastMs = latencyLastMicros.load(std::memory_order_relaxed) / 1000.0;
+    stats.maxMs = latencyMaxMicros.load(std::memory_order_relaxed) / 1000.0;
+    stats.averageMs = stats.sounds > 0
+        ? latencyTotalMicros.load(std::memory_order_relaxed) / 1000.0 / stats.sounds : 0.0;
+    stats.bufferMs = bufferMs;
+    return stats;
+}
+
+void AudioMixer::clean() {
+    if (device != 0) {
+        SDL_CloseAudioDevice(device);
+        device = 0;
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+    }
+    if (droppedCommands > 0) {
+        std::cerr << "Audio dropped " << droppedCommands << " commands" << std::endl;
+    }
+
+    // Clean up the instance
+    delete instance;
+    instance = nullptr;
+}
@@ -0,0 +1,127 @@
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include <SDL2/SDL.h>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Sound effects the game can trigger
+enum class SoundID {
+    COIN,
+    CRASH,
+    FINISH,
+    COUNT
+};
+
+// Time from playSound() until the sound reaches the device, measured by the mixer
+struct AudioLatencyStats {
+    uint64_t sounds;           // Sounds measured
+    double lastMs;
+    double averageMs;
+    double maxMs;
+    double bufferMs;           // Length of one device buffer, included in the figures above
+};
+
+const int AUDIO_FREQUENCY                   = 48000;
+const int AUDIO_BUFFER_SAMPLES              = 256;  // ~5.3 ms per callback at 48 kHz
+const int AUDIO_COMMAND_QUEUE_SIZE          = 64;   // Power of two
+const int AUDIO_MAX_VOICES                  = 16;   // Sound effects playing at once
+const float AUDIO_MUSIC_VOLUME              = 0.35f;
+const double AUDIO_LATENCY_TARGET_MS        = 20.0;
+
+// Software mixer running in the SDL audio callback. Every clip is decoded to
+// mono float PCM at AUDIO_FREQUENCY when the mixer opens, so the callback only
+// adds samples. The game thread talks to the callback through a single-producer
+// single-consumer ring of commands and never takes a lock; call it from one
+// thread only.
+// Set SDL_AUDIODRIVER (or pass a driver to init) to "dummy" or "disk" to run
+// without a sound card.
+class AudioMixer {
+private:
+    static AudioMixer* instance;
+
+    enum class CommandType : uint8_t {
+        PLAY_SOUND,
+        SET_MUSIC,
+        SET_SOUND
+    };
+
+    struct Command {
+        CommandType type;
+        int sound;
+        float volume;
+        bool enabled;
+        Uint64 issued;         // Performance counter when the game thread queued it
+    };
+
+    struct Voice {
+        const float* samples;
+        int length;
+        int position;
+        float volume;
+    };
+
+    // Written by the game thread (head) and the audio thread (tail) only
+    Command commands[AUDIO_COMMAND_QUEUE_SIZE];
+    std::atomic<uint32_t> commandHead;
+    std::atomic<uint32_t> commandTail;
+
+    // Owned by the audio thread once the device is running
+    Voice voices[AUDIO_MAX_VOICES];
+    int musicPosition;
+    bool musicPlaying;
+    bool soundPlaying;
+
+    // Filled before the device starts and never resized afterwards
+    std::vector<float> clips[static_cast<int>(SoundID::COUNT)];
+    std::vector<float> music;
+
+    SDL_AudioDeviceID device;
+    double bufferMs;
+    bool soundEnabled;         // Game thread's copy, so disabled sounds are not queued
+    uint32_t droppedCommands;
+
+    std::atomic<uint64_t> latencyCount;
+    std::atomic<uint64_t> latencyTotalMicros;
+    std::atomic<uint64_t> latencyLastMicros;
+    std::atomic<uint64_t> latencyMaxMicros;
+
+    AudioMixer();
+
+    static void audioCallback(void* userdata, Uint8* stream, int length);
+    void mix(float* output, int frames);
+    void runCommands(Uint64 now);
+    void recordLatency(Uint64 issued, Uint64 now);
+    bool pushCommand(const Command& command);
+
+    bool loadClip(const std::string& fileName, std::vector<float>& clip);
+    void synthesizeClips();
+
+public:
+    AudioMixer(const AudioMixer&) = delete;
+    AudioMixer& operator=(const AudioMixer&) = delete;
+
+    // Get singleton instance
+    static AudioMixer* Instance();
+
+    // Open the audio device and decode every clip; driverName overrides SDL's choice
+    bool init(const char* driverName = nullptr);
+
+    // Queue a sound effect; ignored while sound effects are off or the device is closed
+    void playSound(SoundID sound, float volume = 1.0f);
+    void setMusicEnabled(bool enabled);
+    void setSoundEnabled(bool enabled);
+
+    bool isOpen() const;
+    AudioLatencyStats getLatencyStats() const;
+
+    // Close the device and free the clips
+    void clean();
+};
+
+// Shorthand for accessing the audio mixer
+typedef AudioMixer TheAudioMixer;
+
+#endif // AUDIO_H
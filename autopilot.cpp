@@ -0,0 +1,294 @@
+#include "autopilot.h"
+#include "gamemap.h"
+#include "entities.h"
+#include "replay.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+static const uint32_t ALL_COLUMNS = (GRID_COLS < 32) ? (1u << GRID_COLS) - 1 : 0xFFFFFFFFu;
+
+static uint32_t columnSpan(int first, int last) {
+    first = std::max(first, 0);
+    last = std::min(last, GRID_COLS - 1);
+    uint32_t mask = 0;
+    for (int col = first; col <= last; ++col) {
+        mask |= 1u << col;
+    }
+    return mask;
+}
+
+// Set column nearest to col, or -1 for an empty mask
+static int nearestColumn(uint32_t mask, int col) {
+    for (int distance = 0; distance < GRID_COLS; ++distance) {
+        if (col - distance >= 0 && (mask & (1u << (col - distance)))) {
+            return col - distance;
+        }
+        if (col + distance < GRID_COLS && (mask & (1u << (col + distance)))) {
+            return col + distance;
+        }
+    }
+    return -1;
+}
+
+// Where a sliding hazard is after travelling through x, bouncing between 0 and range
+static float foldPosition(float x, float range) {
+    float folded = std::fmod(x, 2.0f * range);
+    if (folded < 0.0f) {
+        folded += 2.0f * range;
+    }
+    return folded <= range ? folded : 2.0f * range - folded;
+}
+
+// Widest run of adjacent set columns; of equally wide runs, the one starting nearest col
+static uint32_t widestRun(uint32_t mask, int col) {
+    int bestFirst = -1;
+    int bestWidth = 0;
+    for (int first = 0; first < GRID_COLS; ) {
+        if (!(mask & (1u << first))) {
+            ++first;
+            continue;
+        }
+        int end = first;
+        while (end < GRID_COLS && (mask & (1u << end))) {
+            ++end;
+        }
+        if (end - first > bestWidth ||
+            (end - first == bestWidth && std::abs(first - col) < std::abs(bestFirst - col))) {
+            bestFirst = first;
+            bestWidth = end - first;
+        }
+        first = end;
+    }
+    return bestWidth > 0 ? columnSpan(bestFirst, bestFirst + bestWidth - 1) : 0;
+}
+
+Autopilot::Autopilot()
+    : plannedColumn(-1) {
+    std::fill(freeColumns, freeColumns + AUTOPILOT_HORIZON, ALL_COLUMNS);
+    std::fill(reachable, reachable + AUTOPILOT_HORIZON, 0u);
+}
+
+void Autopilot::findFreeColumns(const GameMap& map, const SDL_Rect& playerRect, const EntityWorld* entities) {
+    int playerTop = playerRect.y;
+    int playerBottom = playerRect.y + playerRect.h;
+
+    // Rows touching the player during step k are those now between one row above its
+    // top (k + 1) rows up and its bottom k rows up
+    for (int step = 0; step < AUTOPILOT_HORIZON; ++step) {
+        int top = playerTop - (step + 1) * GRID_SIZE;
+        int bottom = playerBottom - 1 - step * GRID_SIZE;
+        uint32_t blocked = 0;
+        for (int y = top; ; y = std::min(y + GRID_SIZE, bottom)) {
+            // Rows not generated yet come back as nullptr and count as free
+            const RowOccupancy* row = map.getRowAt(y);
+            if (row) {
+                blocked |= row->obstacles;
+            }
+            if (y == bottom) {
+                break;
+            }
+        }
+        freeColumns[step] = ~blocked & ALL_COLUMNS;
+    }
+
+    if (!entities) {
+        return;
+    }
+
+    // Hazards keep their velocity, scroll with the map and bounce off the screen sides
+    const ComponentArray<Position>& positions = entities->getPositions();
+    const ComponentArray<Velocity>& velocities = entities->getVelocities();
+    const ComponentArray<Collider>& colliders = entities->getColliders();
+    const uint32_t* owners = entities->getHazards().entities();
+    for (size_t i = 0, count = entities->getHazards().size(); i < count; ++i) {
+        const Position* position = positions.get(owners[i]);
+        const Collider* collider = colliders.get(owners[i]);
+        const Velocity* velocity = velocities.get(owners[i]);
+        if (!position || !collider) {
+            continue;
+        }
+        float left = position->x + collider->offsetX;
+        float top = position->y + collider->offsetY;
+        float speedX = velocity ? velocity->x : 0.0f;
+        float speedY = SCROLL_SPEED + (velocity ? velocity->y : 0.0f);
+        float range = static_cast<float>(SCREEN_WIDTH - collider->width);
+
+        for (int step = 0; step < AUTOPILOT_HORIZON; ++step) {
+            float startTicks = static_cast<float>(step * AUTOPILOT_STEP_TICKS);
+            float endTicks = startTicks + AUTOPILOT_STEP_TICKS;
+            float topFrom = top + speedY * startTicks;
+            float topTo = top + speedY * endTicks;
+            if (std::min(topFrom, topTo) >= playerBottom || std::max(topFrom, topTo) + collider->height <= playerTop) {
+                continue;
+            }
+
+            float from = left + speedX * startTicks;
+            float to = left + speedX * endTicks;
+            if (from > to) {
+                std::swap(from, to);
+            }
+            float minLeft, maxLeft;
+            if (range <= 0.0f || to - from >= 2.0f * range) {
+                minLeft = 0.0f;
+                maxLeft = std::max(range, 0.0f);
+            } else {
+                // The path folds back at each multiple of range it crosses
+                minLeft = std::min(foldPosition(from, range), foldPosition(to, range));
+                maxLeft = std::max(foldPosition(from, range), foldPosition(to, range));
+                int firstEdge = static_cast<int>(std::floor(from / range)) + 1;
+                int lastEdge = static_cast<int>(std::floor(to / range));
+                for (int edge = firstEdge; edge <= lastEdge; ++edge) {
+                    if (edge % 2 == 0) {
+                        minLeft = 0.0f;
+                    } else {
+                        maxLeft = range;
+                    }
+                }
+            }
+            int firstCol = static_cast<int>(minLeft) / GRID_SIZE;
+            int lastCol = (static_cast<int>(maxLeft) + collider->width - 1) / GRID_SIZE;
+            freeColumns[step] &= ~columnSpan(firstCol, lastCol);
+        }
+    }
+}
+
+uint8_t Autopilot::chooseInput(const GameMap& map, const SDL_Rect& playerRect, const EntityWorld* entities) {
+    findFreeColumns(map, playerRect, entities);
+
+    // Spread from the columns the player overlaps now, one step at a time
+    uint32_t previous = columnSpan(playerRect.x / GRID_SIZE, (playerRect.x + playerRect.w - 1) / GRID_SIZE);
+    int depth = -1;
+    for (int step = 0; step < AUTOPILOT_HORIZON; ++step) {
+        uint32_t free = freeColumns[step];
+        uint32_t stay = previous & free;
+        uint32_t reach = stay;
+        uint32_t left = stay;
+        uint32_t right = stay;
+        for (int shift = 0; shift < AUTOPILOT_COLUMNS_PER_STEP; ++shift) {
+            left = (left >> 1) & free;
+            right = (right << 1) & free;
+            reach |= left | right;
+        }
+        if (reach == 0) {
+            break;
+        }
+        reachable[step] = reach;
+        previous = reach;
+        depth = step;
+    }
+
+    int playerColumn = (playerRect.x + playerRect.w / 2) / GRID_SIZE;
+    if (depth < 0) {
+        // Boxed in: head for the nearest column that is clear right now, if any
+        plannedColumn = nearestColumn(freeColumns[0], playerColumn);
+    } else {
+        // Walk back from the deepest step, staying put where the path allows, so moves
+        // happen as early as possible
+        int column = nearestColumn(widestRun(reachable[depth], playerColumn), playerColumn);
+        for (int step = depth; step > 0; --step) {
+            int best = -1;
+            for (int distance = 0; distance <= AUTOPILOT_COLUMNS_PER_STEP && best < 0; ++distance) {
+                int candidates[2] = {column - distance, column + distance};
+                // Of two equally short moves, take the one towards the player
+                if (std::abs(candidates[1] - playerColumn) < std::abs(candidates[0] - playerColumn)) {
+                    std::swap(candidates[0], candidates[1]);
+                }
+                for (int from : candidates) {
+                    if (from < 0 || from >= GRID_COLS || !(reachable[step - 1] & (1u << from))) {
+                        continue;
+                    }
+                    uint32_t crossed = columnSpan(std::min(from, column), std::max(from, column));
+                    if ((freeColumns[step] & crossed) == crossed) {
+                        best = from;
+                        break;
+                    }
+                }
+            }
+            column = best;
+        }
+        plannedColumn = column;
+    }
+
+    // Steer until the player sits inside the planned column
+    if (plannedColumn < 0) {
+        return 0;
+    }
+    int slotLeft = plannedColumn * GRID_SIZE;
+    int slotRight = slotLeft + GRID_SIZE - playerRect.w;
+    if (playerRect.x < slotLeft) {
+        return INPUT_RIGHT;
+    }
+    if (playerRect.x > slotRight) {
+        return INPUT_LEFT;
+    }
+    return 0;
+}
+
+int Autopilot::getPlannedColumn() const {
+    return plannedColumn;
+}
+
+SurvivalStats::SurvivalStats()
+    : finished(0),
+      timedOut(0),
+      ticks(0),
+      planMicros(0.0),
+      maxPlanMicros(0.0) {
+}
+
+void SurvivalStats::recordPlan(double micros) {
+    planMicros += micros;
+    maxPlanMicros = std::max(maxPlanMicros, micros);
+}
+
+void SurvivalStats::recordGame(int rows, uint64_t gameTicks, bool reachedFinish, bool hitTickLimit) {
+    distances.push_back(rows);
+    ticks += gameTicks;
+    finished += reachedFinish ? 1 : 0;
+    timedOut += hitTickLimit ? 1 : 0;
+}
+
+void SurvivalStats::print(double seconds) const {
+    if (distances.empty()) {
+        std::cout << "Soak: no games played" << std::endl;
+        return;
+    }
+    std::vector<int> sorted(distances);
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&sorted](double fraction) {
+        size_t rank = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5);
+        return sorted[rank];
+    };
+    double total = 0.0;
+    for (int rows : sorted) {
+        total += rows;
+    }
+
+    size_t games = sorted.size();
+    std::cout << "Soak: " << games << " games in " << seconds << " s ("
+              << (seconds > 0.0 ? games * 60.0 / seconds : 0.0) << " games/min, "
+              << (seconds > 0.0 ? ticks / seconds : 0.0) << " ticks/s)" << std::endl;
+    std::cout << "  crashed " << games - finished - timedOut << ", finished " << finished
+              << ", still alive at the tick limit " << timedOut << std::endl;
+    std::cout << "  distance in rows: mean " << total / games << ", min " << sorted.front()
+              << ", p10 " << percentile(0.10) << ", p25 " << percentile(0.25) << ", p50 " << percentile(0.50)
+              << ", p75 " << percentile(0.75) << ", p90 " << percentile(0.90) << ", max " << sorted.back() << std::endl;
+    if (ticks > 0) {
+        std::cout << "  planning: " << planMicros / ticks << " us per tick average, "
+                  << maxPlanMicros << " us max" << std::endl;
+    }
+
+    // Ten equal-width bins up to the longest game
+    const int binCount = 10;
+    int binWidth = std::max(1, (sorted.back() + binCount) / binCount);
+    int bins[binCount] = {};
+    for (int rows : sorted) {
+        ++bins[std::min(rows / binWidth, binCount - 1)];
+    }
+    size_t largest = *std::max_element(bins, bins + binCount);
+    for (int bin = 0; bin < binCount; ++bin) {
+        std::cout << "  " << bin * binWidth << "-" << (bin + 1) * binWidth - 1 << " rows: " << bins[bin] << " "
+                  << std::string(largest > 0 ? bins[bin] * 40 / largest : 0, '#') << std::endl;
+    }
+}
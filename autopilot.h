@@ -0,0 +1,67 @@
+#ifndef AUTOPILOT_H
+#define AUTOPILOT_H
+
+#include <SDL2/SDL.h>
+#include <cstdint>
+#include <vector>
+#include "constants.h"
+
+class GameMap;
+class EntityWorld;
+
+const int AUTOPILOT_HORIZON                 = 14;    // Grid rows planned ahead, up to the top of the screen
+const int AUTOPILOT_STEP_TICKS              = static_cast<int>(GRID_SIZE / SCROLL_SPEED); // Ticks for the map to scroll one row
+// Columns the player can cross while the map scrolls one row
+const int AUTOPILOT_COLUMNS_PER_STEP        = static_cast<int>(PLAYER_SPEED * AUTOPILOT_STEP_TICKS) / GRID_SIZE;
+const int AUTOPILOT_SOAK_GAMES              = 1000;  // Default length of --soak
+const uint32_t AUTOPILOT_SOAK_SEED          = 1;     // Seed of the first soak game; each game adds one
+const int AUTOPILOT_SOAK_MAX_TICKS          = 60 * 60 * 10; // A soak game still alive after 10 minutes ends there
+
+static_assert(AUTOPILOT_COLUMNS_PER_STEP >= 1, "The autopilot plans at least one column of movement per row");
+
+// Steers the player through the rows coming down at it. Time is cut into steps of one
+// row of scrolling; a column is free in a step when no obstacle or projected hazard
+// touches it while it passes the player. A breadth-first search then spreads a bitmask
+// of reachable columns one step at a time (stay, or move AUTOPILOT_COLUMNS_PER_STEP
+// across free columns), walks back from the deepest step it reached, and steers
+// towards the column that path needs at the end of the first step. At the deepest step
+// it aims for the widest run of reachable columns, which leaves the most ways out of
+// whatever comes after the horizon.
+class Autopilot {
+private:
+    uint32_t freeColumns[AUTOPILOT_HORIZON];
+    uint32_t reachable[AUTOPILOT_HORIZON];
+    int plannedColumn;      // Column the last plan steers to, -1 if it found none
+
+    void findFreeColumns(const GameMap& map, const SDL_Rect& playerRect, const EntityWorld* entities);
+
+public:
+    Autopilot();
+
+    // INPUT_LEFT, INPUT_RIGHT or 0 for the next tick, as the keyboard would give.
+    // entities is optional; without it only the map is avoided.
+    uint8_t chooseInput(const GameMap& map, const SDL_Rect& playerRect, const EntityWorld* entities = nullptr);
+    int getPlannedColumn() const;
+};
+
+// Distances (in rows) reached by soak-test games, summarized when printed
+class SurvivalStats {
+private:
+    std::vector<int> distances;
+    int finished;
+    int timedOut;
+    uint64_t ticks;
+    double planMicros;
+    double maxPlanMicros;
+
+public:
+    SurvivalStats();
+
+    void recordPlan(double micros);
+    // One game: rows scrolled, and whether it reached the finish or hit the tick limit
+    void recordGame(int rows, uint64_t gameTicks, bool reachedFinish, bool hitTickLimit);
+    // Percentiles, a histogram of distances and planning cost
+    void print(double seconds) const;
+};
+
+#endif // AUTOPILOT_H
@@ -0,0 +1,222 @@
+#include "broadphase.h"
+#include "gridmath.h"
+#include <algorithm>
+#include <cmath>
+
+static bool rectsOverlap(const SDL_Rect& a, const SDL_Rect& b) {
+    return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h;
+}
+
+Broadphase::Broadphase(size_t capacity)
+    : bucketHeads(BROADPHASE_ROWS * GRID_COLS, NONE),
+      next(capacity, NONE),
+      prev(capacity, NONE),
+      bucketOf(capacity, NONE),
+      boxes(capacity),
+      seenTick(capacity, 0),
+      memberSlot(capacity, NONE),
+      isOversized(capacity, 0),
+      tick(0),
+      worldTop(0),
+      moves(0) {
+    members.reserve(capacity);
+    oversized.reserve(capacity);
+}
+
+int Broadphase::bucketFor(int centerX, int centerY) const {
+    int col = std::min(GRID_COLS - 1, std::max(0, floorDiv(centerX, GRID_SIZE)));
+    int row = floorDiv(centerY - worldTop, GRID_SIZE) % BROADPHASE_ROWS;
+    if (row < 0) {
+        row += BROADPHASE_ROWS;
+    }
+    return row * GRID_COLS + col;
+}
+
+void Broadphase::link(uint32_t index, uint32_t bucket) {
+    bucketOf[index] = bucket;
+    prev[index] = NONE;
+    next[index] = bucketHeads[bucket];
+    if (next[index] != NONE) {
+        prev[next[index]] = index;
+    }
+    bucketHeads[bucket] = index;
+}
+
+void Broadphase::unlink(uint32_t index) {
+    uint32_t bucket = bucketOf[index];
+    if (bucket == NONE) {
+        return;
+    }
+    if (prev[index] != NONE) {
+        next[prev[index]] = next[index];
+    } else {
+        bucketHeads[bucket] = next[index];
+    }
+    if (next[index] != NONE) {
+        prev[next[index]] = prev[index];
+    }
+    bucketOf[index] = NONE;
+}
+
+void Broadphase::file(uint32_t index) {
+    memberSlot[index] = static_cast<uint32_t>(members.size());
+    members.push_back(index);
+}
+
+void Broadphase::removeOversized(uint32_t index) {
+    auto big = std::find(oversized.begin(), oversized.end(), index);
+    if (big != oversized.end()) {
+        *big = oversized.back();
+        oversized.pop_back();
+    }
+    isOversized[index] = 0;
+}
+
+void Broadphase::unfile(uint32_t index) {
+    unlink(index);
+    if (isOversized[index]) {
+        removeOversized(index);
+    }
+    
+    uint32_t slot = memberSlot[index];
+    members[slot] = members.back();
+    memberSlot[members[slot]] = slot;
+    members.pop_back();
+    memberSlot[index] = NONE;
+}
+
+void Broadphase::update(const EntityWorld& world, float scrollPosition) {
+    ++tick;
+    moves = 0;
+    
+    // Moves with the map, so a row that scrolls keeps its bucket. Wrapping after a
+    // whole ring of rows keeps it small without changing which bucket a row hashes to.
+    worldTop = static_cast<int>(std::floor(scrollPosition)) % (BROADPHASE_ROWS * GRID_SIZE);
+    
+    const ComponentArray<Collider>& colliders = world.getColliders();
+    const ComponentArray<Position>& positions = world.getPositions();
+    const Collider* collider = colliders.data();
+    const uint32_t* owners = colliders.entities();
+    
+    for (size_t i = 0, count = colliders.size(); i < count; ++i) {
+        uint32_t index = owners[i];
+        const Position* position = positions.get(index);
+        if (!position) {
+            continue;
+        }
+        seenTick[index] = tick;
+        
+        SDL_Rect& box = boxes[index];
+        box = {static_cast<int>(position->x) + collider[i].offsetX, static_cast<int>(position->y) + collider[i].offsetY,
+               collider[i].width, collider[i].height};
+        
+        if (memberSlot[index] == NONE) {
+            file(index);
+        }
+        
+        if (box.w > GRID_SIZE || box.h > GRID_SIZE) {
+            if (!isOversized[index]) {
+                unlink(index);
+                isOversized[index] = 1;
+                oversized.push_back(index);
+                ++moves;
+            }
+            continue;
+        }
+        if (isOversized[index]) {
+            removeOversized(index);
+        }
+        
+        uint32_t bucket = bucketFor(box.x + box.w / 2, box.y + box.h / 2);
+        if (bucket != bucketOf[index]) {
+            unlink(index);
+            link(index, bucket);
+            ++moves;
+        }
+    }
+    
+    // Entities that lost their collider or were destroyed since the last update
+    for (size_t i = 0; i < members.size();) {
+        uint32_t index = members[i];
+        if (seenTick[index] != tick) {
+            unfile(index);
+        } else {
+            ++i;
+        }
+    }
+}
+
+int Broadphase::query(const SDL_Rect& rect, uint32_t* results, int maxResults) const {
+    int found = 0;
+    
+    // Centres of overlapping colliders lie at most half a cell outside rect
+    int half = GRID_SIZE / 2;
+    int firstCol = std::max(0, floorDiv(rect.x - half, GRID_SIZE));
+    int lastCol = std::min(GRID_COLS - 1, floorDiv(rect.x + rect.w + half, GRID_SIZE));
+    int firstRow = floorDiv(rect.y - half - worldTop, GRID_SIZE);
+    int lastRow = floorDiv(rect.y + rect.h + half - worldTop, GRID_SIZE);
+    if (lastRow - firstRow >= BROADPHASE_ROWS) {
+        lastRow = firstRow + BROADPHASE_ROWS - 1;   // Every row bucket already covered
+    }
+    
+    for (int row = firstRow; row <= lastRow; ++row) {
+        int hashedRow = row % BROADPHASE_ROWS;
+        if (hashedRow < 0) {
+            hashedRow += BROADPHASE_ROWS;
+        }
+        for (int col = firstCol; col <= lastCol; ++col) {
+            for (uint32_t index = bucketHeads[hashedRow * GRID_COLS + col]; index != NONE; index = next[index]) {
+                if (rectsOverlap(rect, boxes[index])) {
+                    if (found == maxResults) {
+                        return found;
+                    }
+                    results[found++] = index;
+                }
+            }
+        }
+    }
+    
+    for (uint32_t index : oversized) {
+        if (rectsOverlap(rect, boxes[index])) {
+            if (found == maxResults) {
+                return found;
+            }
+            results[found++] = index;
+        }
+    }
+    return found;
+}
+
+int Broadphase::queryPairs(EntityPair* pairs, int maxPairs) const {
+    int found = 0;
+    uint32_t nearby[BROADPHASE_MAX_NEIGHBOURS];
+    
+    for (uint32_t index : members) {
+        int count = query(boxes[index], nearby, BROADPHASE_MAX_NEIGHBOURS);
+        for (int i = 0; i < count; ++i) {
+            // Report each pair from its lower index only
+            if (nearby[i] <= index) {
+                continue;
+            }
+            if (found == maxPairs) {
+                return found;
+            }
+            pairs[found++] = EntityPair{index, nearby[i]};
+        }
+    }
+    return found;
+}
+
+void Broadphase::clear() {
+    while (!members.empty()) {
+        unfile(members.back());
+    }
+}
+
+size_t Broadphase::size() const {
+    return members.size();
+}
+
+size_t Broadphase::getLastMoveCount() const {
+    return moves;
+}
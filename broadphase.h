@@ -0,0 +1,68 @@
+#ifndef BROADPHASE_H
+#define BROADPHASE_H
+
+#include <SDL2/SDL.h>
+#include <cstdint>
+#include <vector>
+#include "constants.h"
+#include "entities.h"
+
+// Two entities whose colliders overlap; first < second
+struct EntityPair {
+    uint32_t first;
+    uint32_t second;
+};
+
+// Uniform grid over entity colliders, using the map's cells: bucket column is the map
+// column and bucket row is the map row minus GameMap::getScrolledRows(), so a row keeps
+// its bucket while it scrolls and stationary entities never change bucket. Rows are
+// hashed into BROADPHASE_ROWS buckets.
+// Each entity is filed under the cell holding its collider's centre. Colliders up to
+// GRID_SIZE wide and high therefore reach at most half a cell into a neighbour, and
+// queries widen by that much; larger colliders go on a separate list every query checks.
+class Broadphase {
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    std::vector<uint32_t> bucketHeads;  // First entity in each bucket
+    std::vector<uint32_t> next;         // Intrusive doubly-linked bucket lists, by entity index
+    std::vector<uint32_t> prev;
+    std::vector<uint32_t> bucketOf;     // Bucket of each filed entity, NONE if not filed
+    std::vector<SDL_Rect> boxes;        // Collider in screen space as of the last update()
+    std::vector<uint32_t> seenTick;
+    std::vector<uint32_t> members;      // Filed entities
+    std::vector<uint32_t> memberSlot;   // Entity index -> position in members
+    std::vector<uint32_t> oversized;    // Entities too big for the loose cells
+    std::vector<uint8_t> isOversized;
+    uint32_t tick;
+    int worldTop;                       // Screen y of bucket row 0's top edge
+    size_t moves;                       // Entities that changed bucket in the last update()
+
+    int bucketFor(int centerX, int centerY) const;
+    void link(uint32_t index, uint32_t bucket);
+    void unlink(uint32_t index);
+    void file(uint32_t index);
+    void unfile(uint32_t index);
+    void removeOversized(uint32_t index);
+
+public:
+    explicit Broadphase(size_t capacity = MAX_ENTITIES);
+
+    // Bring the grid in line with world's colliders. scrollPosition is the map's total
+    // scroll in pixels (GameMap::getScrollPosition). Only entities that changed cell relink.
+    void update(const EntityWorld& world, float scrollPosition);
+
+    // Entity indices whose collider overlaps rect (screen space). Writes at most
+    // maxResults and returns how many were written.
+    int query(const SDL_Rect& rect, uint32_t* results, int maxResults) const;
+
+    // Every pair of overlapping colliders, each once. Returns how many were written;
+    // an entity with more than BROADPHASE_MAX_NEIGHBOURS overlaps reports only that many.
+    int queryPairs(EntityPair* pairs, int maxPairs) const;
+
+    void clear();
+    size_t size() const;
+    size_t getLastMoveCount() const;
+};
+
+#endif // BROADPHASE_H
@@ -0,0 +1,343 @@
+#include "capture.h"
+#include <iostream>
+#include <chrono>
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define CAPTURE_X86 1
+#include <emmintrin.h>
+#endif
+
+// Integer BT.601 full range ("C420jpeg"), 8 fractional bits. The chroma bias is
+// 128.5 * 256 - 1 so every sum stays within 0..65535: the SSE2 path works in
+// wrapping 16-bit lanes and gets the same values without clamping.
+static inline uint8_t lumaOf(int r, int g, int b) {
+    return static_cast<uint8_t>((77 * r + 150 * g + 29 * b + 128) >> 8);
+}
+
+static inline uint8_t blueDifferenceOf(int r, int g, int b) {
+    return static_cast<uint8_t>((128 * b - 43 * r - 85 * g + 32895) >> 8);
+}
+
+static inline uint8_t redDifferenceOf(int r, int g, int b) {
+    return static_cast<uint8_t>((128 * r - 107 * g - 21 * b + 32895) >> 8);
+}
+
+// Luma of count pixels from column x of one row
+static void convertLumaScalar(const uint32_t* row, int x, int count, uint8_t* yRow) {
+    for (int end = x + count; x < end; ++x) {
+        uint32_t pixel = row[x];
+        yRow[x] = lumaOf((pixel >> 16) & 0xFF, (pixel >> 8) & 0xFF, pixel & 0xFF);
+    }
+}
+
+// Chroma for 2x2 blocks starting at column x (even) up to width; the last column and
+// row repeat when the image size is odd
+static void convertChromaScalar(const uint32_t* row0, const uint32_t* row1, int x, int width,
+                                uint8_t* uRow, uint8_t* vRow) {
+    for (; x < width; x += 2) {
+        int x1 = (x + 1 < width) ? x + 1 : x;
+        uint32_t block[4] = {row0[x], row0[x1], row1[x], row1[x1]};
+        int r = 2, g = 2, b = 2;
+        for (uint32_t pixel : block) {
+            r += (pixel >> 16) & 0xFF;
+            g += (pixel >> 8) & 0xFF;
+            b += pixel & 0xFF;
+        }
+        uRow[x / 2] = blueDifferenceOf(r >> 2, g >> 2, b >> 2);
+        vRow[x / 2] = redDifferenceOf(r >> 2, g >> 2, b >> 2);
+    }
+}
+
+#ifdef CAPTURE_X86
+// Channels of four ARGB pixels, one per 32-bit lane
+__attribute__((target("sse2")))
+static inline void splitChannels(__m128i pixels, __m128i& r, __m128i& g, __m128i& b) {
+    const __m128i mask = _mm_set1_epi32(0xFF);
+    r = _mm_and_si128(_mm_srli_epi32(pixels, 16), mask);
+    g = _mm_and_si128(_mm_srli_epi32(pixels, 8), mask);
+    b = _mm_and_si128(pixels, mask);
+}
+
+// Luma of 8 pixels in 16-bit lanes
+__attribute__((target("sse2")))
+static inline __m128i luma8(const uint32_t* pixels) {
+    __m128i r0, g0, b0, r1, g1, b1;
+    splitChannels(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels)), r0, g0, b0);
+    splitChannels(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + 4)), r1, g1, b1);
+    __m128i sum = _mm_add_epi16(_mm_mullo_epi16(_mm_packs_epi32(r0, r1), _mm_set1_epi16(77)),
+                                _mm_mullo_epi16(_mm_packs_epi32(g0, g1), _mm_set1_epi16(150)));
+    sum = _mm_add_epi16(sum, _mm_mullo_epi16(_mm_packs_epi32(b0, b1), _mm_set1_epi16(29)));
+    return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(128)), 8);
+}
+
+// Sums of horizontal pixel pairs: lanes 0 and 1 of the result hold (0+1) and (2+3)
+__attribute__((target("sse2")))
+static inline __m128i pairSums(__m128i channel) {
+    __m128i sums = _mm_add_epi32(channel, _mm_srli_epi64(channel, 32));
+    return _mm_shuffle_epi32(sums, _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+// 2x2 block averages of one channel over 16 columns of two rows, as 8 16-bit lanes
+__attribute__((target("sse2")))
+static inline __m128i blockAverages(const __m128i rows[4]) {
+    __m128i low = _mm_unpacklo_epi64(pairSums(rows[0]), pairSums(rows[1]));
+    __m128i high = _mm_unpacklo_epi64(pairSums(rows[2]), pairSums(rows[3]));
+    return _mm_srli_epi16(_mm_add_epi16(_mm_packs_epi32(low, high), _mm_set1_epi16(2)), 2);
+}
+
+// Luma for two rows and chroma for the blocks between them, 16 columns at a time;
+// returns the first column left for the scalar code
+__attribute__((target("sse2")))
+static int convertRowPairSse2(const uint32_t* row0, const uint32_t* row1, int width,
+                              uint8_t* yRow0, uint8_t* yRow1, uint8_t* uRow, uint8_t* vRow) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(yRow0 + x), _mm_packus_epi16(luma8(row0 + x), luma8(row0 + x + 8)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(yRow1 + x), _mm_packus_epi16(luma8(row1 + x), luma8(row1 + x + 8)));
+
+        __m128i red[4], green[4], blue[4];
+        for (int i = 0; i < 4; ++i) {
+            __m128i r0, g0, b0, r1, g1, b1;
+            splitChannels(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x + i * 4)), r0, g0, b0);
+            splitChannels(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x + i * 4)), r1, g1, b1);
+            red[i] = _mm_add_epi32(r0, r1);
+            green[i] = _mm_add_epi32(g0, g1);
+            blue[i] = _mm_add_epi32(b0, b1);
+        }
+        __m128i r = blockAverages(red);
+        __m128i g = blockAverages(green);
+        __m128i b = blockAverages(blue);
+
+        // Same sums as the scalar code, wrapping in 16 bits to the same result
+        const __m128i bias = _mm_set1_epi16(static_cast<short>(32895));
+        __m128i u = _mm_sub_epi16(_mm_add_epi16(_mm_slli_epi16(b, 7), bias),
+                                  _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(43)),
+                                                _mm_mullo_epi16(g, _mm_set1_epi16(85))));
+        __m128i v = _mm_sub_epi16(_mm_add_epi16(_mm_slli_epi16(r, 7), bias),
+                                  _mm_add_epi16(_mm_mullo_epi16(g, _mm_set1_epi16(107)),
+                                                _mm_mullo_epi16(b, _mm_set1_epi16(21))));
+        __m128i zero = _mm_setzero_si128();
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(uRow + x / 2), _mm_packus_epi16(_mm_srli_epi16(u, 8), zero));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(vRow + x / 2), _mm_packus_epi16(_mm_srli_epi16(v, 8), zero));
+    }
+    return x;
+}
+#endif
+
+void convertToYuv420(const uint32_t* pixels, int pitch, int width, int height,
+                     uint8_t* yPlane, uint8_t* uPlane, uint8_t* vPlane) {
+#ifdef CAPTURE_X86
+    static const bool sse2 = __builtin_cpu_supports("sse2");
+#endif
+    int chromaWidth = (width + 1) / 2;
+    for (int y = 0; y < height; y += 2) {
+        int y1 = (y + 1 < height) ? y + 1 : y;
+        const uint32_t* row0 = reinterpret_cast<const uint32_t*>(reinterpret_cast<const uint8_t*>(pixels) + y * pitch);
+        const uint32_t* row1 = reinterpret_cast<const uint32_t*>(reinterpret_cast<const uint8_t*>(pixels) + y1 * pitch);
+        uint8_t* yRow0 = yPlane + y * width;
+        uint8_t* yRow1 = yPlane + y1 * width;
+        uint8_t* uRow = uPlane + (y / 2) * chromaWidth;
+        uint8_t* vRow = vPlane + (y / 2) * chromaWidth;
+
+        int x = 0;
+#ifdef CAPTURE_X86
+        if (sse2) {
+            x = convertRowPairSse2(row0, row1, width, yRow0, yRow1, uRow, vRow);
+        }
+#endif
+        convertLumaScalar(row0, x, width - x, yRow0);
+        convertLumaScalar(row1, x, width - x, yRow1);
+        convertChromaScalar(row0, row1, x, width, uRow, vRow);
+    }
+}
+
+VideoCapture::VideoCapture()
+    : raw(false),
+      width(0),
+      height(0),
+      readyHead(0),
+      readyCount(0),
+      waitForBuffers(false),
+      stopping(false),
+      writeFailed(false),
+      convertMs(0.0),
+      framesCaptured(0),
+      framesDropped(0),
+      framesWritten(0) {
+}
+
+VideoCapture::~VideoCapture() {
+    stop();
+}
+
+bool VideoCapture::start(const std::string& fileName, SDL_Renderer* renderer) {
+    if (isActive()) {
+        return false;
+    }
+    if (SDL_GetRendererOutputSize(renderer, &width, &height) != 0 || width <= 0 || height <= 0) {
+        std::cerr << "Capture: no renderer output size: " << SDL_GetError() << std::endl;
+        return false;
+    }
+    file.open(fileName, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "Capture: can't write " << fileName << std::endl;
+        return false;
+    }
+    raw = fileName.size() >= 4 && fileName.compare(fileName.size() - 4, 4, ".yuv") == 0;
+    if (!raw) {
+        file << "YUV4MPEG2 W" << width << " H" << height << " F" << CAPTURE_FPS << ":1 Ip A1:1 C420jpeg\n";
+    }
+
+    // Everything is allocated here so capturing a frame never touches the heap
+    buffers.assign(CAPTURE_BUFFER_COUNT, std::vector<uint32_t>(static_cast<size_t>(width) * height));
+    freeBuffers.clear();
+    for (int i = CAPTURE_BUFFER_COUNT - 1; i >= 0; --i) {
+        freeBuffers.push_back(i);
+    }
+    readyBuffers.assign(CAPTURE_BUFFER_COUNT, 0);
+    readyHead = 0;
+    readyCount = 0;
+    int chromaSize = ((width + 1) / 2) * ((height + 1) / 2);
+    yuvFrame.resize(static_cast<size_t>(width) * height + 2 * chromaSize);
+    stopping = false;
+    writeFailed = false;
+    convertMs = 0.0;
+    framesCaptured = 0;
+    framesDropped = 0;
+    framesWritten = 0;
+
+    writer = std::thread(&VideoCapture::writerLoop, this);
+    std::cout << "Capturing " << width << "x" << height << (raw ? " raw I420" : " Y4M")
+              << " to " << fileName << std::endl;
+    return true;
+}
+
+void VideoCapture::setWaitForBuffers(bool wait) {
+    waitForBuffers = wait;
+}
+
+int VideoCapture::takeFreeBuffer() {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (waitForBuffers) {
+        freeCondition.wait(lock, [this] { return !freeBuffers.empty(); });
+    }
+    if (freeBuffers.empty()) {
+        return -1;
+    }
+    int index = freeBuffers.back();
+    freeBuffers.pop_back();
+    return index;
+}
+
+void VideoCapture::captureFrame(SDL_Renderer* renderer) {
+    if (!isActive()) {
+        return;
+    }
+    ++framesCaptured;
+    int index = takeFreeBuffer();
+    if (index < 0) {
+        ++framesDropped;
+        return;
+    }
+
+    // The readback itself is synchronous; only conversion and disk writes are deferred
+    SDL_Rect area = {0, 0, width, height};
+    if (SDL_RenderReadPixels(renderer, &area, SDL_PIXELFORMAT_ARGB8888, buffers[index].data(),
+                             width * static_cast<int>(sizeof(uint32_t))) != 0) {
+        ++framesDropped;
+        std::lock_guard<std::mutex> lock(mutex);
+        freeBuffers.push_back(index);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        readyBuffers[(readyHead + readyCount) % CAPTURE_BUFFER_COUNT] = index;
+        ++readyCount;
+    }
+    readyCondition.notify_one();
+}
+
+void VideoCapture::writerLoop() {
+    int chromaSize = ((width + 1) / 2) * ((height + 1) / 2);
+    uint8_t* yPlane = yuvFrame.data();
+    uint8_t* uPlane = yPlane + static_cast<size_t>(width) * height;
+    uint8_t* vPlane = uPlane + chromaSize;
+
+    for (;;) {
+        int index;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            readyCondition.wait(lock, [this] { return readyCount > 0 || stopping; });
+            if (readyCount == 0) {
+                return; // Stopping with nothing left to write
+            }
+            index = readyBuffers[readyHead];
+            readyHead = (readyHead + 1) % CAPTURE_BUFFER_COUNT;
+            --readyCount;
+        }
+
+        auto convertStart = std::chrono::steady_clock::now();
+        convertToYuv420(buffers[index].data(), width * static_cast<int>(sizeof(uint32_t)), width, height,
+                        yPlane, uPlane, vPlane);
+        convertMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - convertStart).count();
+
+        // The buffer can be reused as soon as it is converted
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            freeBuffers.push_back(index);
+        }
+        freeCondition.notify_one();
+
+        if (!writeFailed) {
+            if (!raw) {
+                file << "FRAME\n";
+            }
+            file.write(reinterpret_cast<const char*>(yuvFrame.data()), static_cast<std::streamsize>(yuvFrame.size()));
+            if (!file) {
+                writeFailed = true;
+            } else {
+                ++framesWritten;
+            }
+        }
+    }
+}
+
+void VideoCapture::stop() {
+    if (!isActive()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    readyCondition.notify_one();
+    writer.join();
+    file.close();
+
+    std::cout << "Capture: " << framesWritten << " frames written, " << framesDropped << " of "
+              << framesCaptured << " dropped";
+    if (framesWritten > 0) {
+        std::cout << ", " << convertMs / framesWritten << " ms per YUV conversion";
+    }
+    std::cout << std::endl;
+    if (writeFailed) {
+        std::cerr << "Capture: writing failed, the file is incomplete" << std::endl;
+    }
+    if (framesDropped > 0) {
+        std::cerr << "Capture: the writer fell behind; dropped frames are missing from the video" << std::endl;
+    }
+    buffers.clear();
+}
+
+bool VideoCapture::isActive() const {
+    return writer.joinable();
+}
+
+uint64_t VideoCapture::getFramesCaptured() const {
+    return framesCaptured;
+}
+
+uint64_t VideoCapture::getFramesDropped() const {
+    return framesDropped;
+}
@@ -0,0 +1,79 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+const int CAPTURE_BUFFER_COUNT              = 8;     // Frames that can wait for the writer before new ones are dropped
+const int CAPTURE_FPS                       = 60;    // Frame rate written to the Y4M header
+
+// Convert packed ARGB8888 (pitch in bytes) to planar YUV 4:2:0, BT.601 full range.
+// Chroma planes are (width + 1) / 2 by (height + 1) / 2; each sample averages a 2x2 block.
+void convertToYuv420(const uint32_t* pixels, int pitch, int width, int height,
+                     uint8_t* yPlane, uint8_t* uPlane, uint8_t* vPlane);
+
+// Records presented frames to a Y4M file, or raw I420 when the name ends in ".yuv".
+// captureFrame reads the frame back into one of a fixed set of buffers and queues it;
+// a writer thread converts and writes it, then hands the buffer back. When every buffer
+// is still queued the frame is dropped instead, so the game never waits on the disk;
+// headless runs have no frame deadline and can wait for a buffer instead.
+class VideoCapture {
+private:
+    std::ofstream file;
+    bool raw;
+    int width;
+    int height;
+
+    std::vector<std::vector<uint32_t>> buffers;
+    std::vector<int> freeBuffers;
+    std::vector<int> readyBuffers;      // Ring of queued buffer indices, oldest at readyHead
+    int readyHead;
+    int readyCount;
+
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable readyCondition;
+    std::condition_variable freeCondition;
+    bool waitForBuffers;
+    bool stopping;
+    bool writeFailed;
+
+    // Only the writer thread touches these until it is joined
+    std::vector<uint8_t> yuvFrame;
+    double convertMs;
+
+    uint64_t framesCaptured;
+    uint64_t framesDropped;
+    uint64_t framesWritten;
+
+    void writerLoop();
+    int takeFreeBuffer();
+
+public:
+    VideoCapture();
+    ~VideoCapture();
+
+    VideoCapture(const VideoCapture&) = delete;
+    VideoCapture& operator=(const VideoCapture&) = delete;
+
+    // Open the file and start the writer for frames of the renderer's output size
+    bool start(const std::string& fileName, SDL_Renderer* renderer);
+    // Wait for the writer rather than drop frames; for runs that aren't real time
+    void setWaitForBuffers(bool wait);
+    // Read back the frame about to be presented; call just before SDL_RenderPresent
+    void captureFrame(SDL_Renderer* renderer);
+    // Write what is queued, stop the writer and print the frame counts
+    void stop();
+
+    bool isActive() const;
+    uint64_t getFramesCaptured() const;
+    uint64_t getFramesDropped() const;
+};
+
+#endif // CAPTURE_H
@@ -10,12 +10,29 @@ const int GRID_SIZE                         = 60; // 40 Size of each grid cell i
 const int GRID_COLS                         = SCREEN_WIDTH / GRID_SIZE;
 const int GRID_ROWS                         = SCREEN_HEIGHT / GRID_SIZE + 1; // +1 for the row being scrolled in
 const int BUFFER_ROWS                       = 10; // Number of rows to pre-generate above screen
+const int MAP_ROWS                          = GRID_ROWS + BUFFER_ROWS; // Rows held by GameMap
 const int PLAYER_WIDTH                      = 50;
 const int PLAYER_HEIGHT                     = 80;
 const float SCROLL_SPEED                    = 3.0f; // Pixels per frame
 const float PLAYER_SPEED                    = 5.0f; // Pixels per frame
 const int MAX_SCORE                         = 1000;
 const int MAX_ROWS                          = 200;
+const int MAP_UPDATE_ROWS_PER_JOB           = 8;  // Grid rows per job when updating cells in parallel
+const int MAP_RENDER_ROWS_PER_JOB           = 4;  // Grid rows per job when building render commands
+const int MAX_ENTITIES                      = 16384; // Dynamic entities alive at once
+const int ENTITY_DESPAWN_Y                  = SCREEN_HEIGHT + GRID_SIZE; // Entities below this are removed
+const int DYNAMIC_SPAWN_INTERVAL            = 90;  // Ticks between moving obstacle/coin spawns
+const float SLIDING_OBSTACLE_SPEED          = 2.0f;
+const float PROJECTILE_SPEED                = 4.0f;
+const float HOMING_COIN_SPEED               = 1.5f;
+const int MAX_COIN_PARTICLES                = 16384; // Live particles per effect emitter
+const int MAX_CRASH_PARTICLES               = 49152;
+const int COIN_PARTICLE_BURST               = 24;    // Particles per collected coin
+const int CRASH_PARTICLE_BURST              = 400;   // Particles when the player dies
+const int BROADPHASE_ROWS                   = 64;  // Row buckets in the entity broadphase (rows wrap around)
+const int BROADPHASE_MAX_NEIGHBOURS         = 256; // Overlaps reported per entity by Broadphase::queryPairs
+const int FRAME_ARENA_BYTES                 = 1024 * 1024; // Per-frame scratch memory
+const int ALLOCATION_WARMUP_FRAMES          = 120; // Gameplay frames before allocations are reported
 
 const std::string PLAYER_TEXTURE_PATH       = "assets/player2.png";
 const std::string OBSTACLE_TEXTURE_PATH     = "assets/obstacle22.png";
@@ -24,12 +41,20 @@ const std::string BACKGROUND_PATH           = "assets/background3.png";
 const std::string FINISH_PATH               = "assets/finish.png";
 const std::string MENU_BACKGROUND_PATH      = "assets/menu_background.jpg";
 const std::string ABOUT_BACKGROUND_PATH     = "assets/about.png";
+const std::string FONT_PATH                 = "assets/arial.ttf";
+const int TEXTURE_MEMORY_BUDGET_MB          = 64;  // Unused textures are evicted beyond this
+const std::string COIN_SOUND_PATH           = "assets/coin.wav";   // Optional; sounds are synthesized
+const std::string CRASH_SOUND_PATH          = "assets/crash.wav";  // when these files are missing
+const std::string FINISH_SOUND_PATH         = "assets/finish.wav";
+const std::string MUSIC_PATH                = "assets/music.wav";
+const std::string ASSET_PACK_PATH           = "assets/assets.pack"; // Built by "main --build-pack"
 
 const int PLAYER_FRAMES                     = 6;
 const int OBSTACLE_FRAMES                   = 2;
 const int OBSTACLE_ANIMATION_SPEED          = 30;
 const int COIN_FRAMES                       = 9;
 const int COIN_ANIMATION_SPEED              = 10;
+const int COLLISION_ALPHA_THRESHOLD         = 128; // Pixels at or above this alpha are solid for collision
 
 // Cell types
 enum class CellType {
@@ -0,0 +1,11 @@
+#include "drawstats.h"
+
+static uint64_t drawCallCount = 0;
+
+void countDrawCall() {
+    ++drawCallCount;
+}
+
+uint64_t getDrawCallCount() {
+    return drawCallCount;
+}
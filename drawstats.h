@@ -0,0 +1,14 @@
+#ifndef DRAWSTATS_H
+#define DRAWSTATS_H
+
+#include <cstdint>
+
+// Draw calls sent to the renderer, counted on the render thread. A texture copy, a
+// geometry batch and a rectangle fill each count once; so does a sprite queued on the
+// CPU renderer, and the copy that presents its frame.
+void countDrawCall();
+
+// Draw calls made since the program started
+uint64_t getDrawCallCount();
+
+#endif // DRAWSTATS_H
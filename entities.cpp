@@ -0,0 +1,350 @@
+#include "entities.h"
+#include "allocators.h"
+#include <algorithm>
+#include <cmath>
+
+EntityWorld::EntityWorld(size_t capacity)
+    : generations(capacity, 0),
+      alive(capacity, 0),
+      positions(capacity),
+      velocities(capacity),
+      sprites(capacity),
+      colliders(capacity),
+      pickups(capacity),
+      hazards(capacity),
+      homings(capacity),
+      homingTargetX(0.0f),
+      homingTargetY(0.0f) {
+    freeIndices.reserve(capacity);
+    doomed.reserve(capacity);
+    // Hand out low indices first
+    for (size_t i = capacity; i > 0; --i) {
+        freeIndices.push_back(static_cast<uint32_t>(i - 1));
+    }
+}
+
+Entity EntityWorld::create() {
+    if (freeIndices.empty()) {
+        return NO_ENTITY;
+    }
+    uint32_t index = freeIndices.back();
+    freeIndices.pop_back();
+    alive[index] = 1;
+    return Entity{index, generations[index]};
+}
+
+void EntityWorld::destroy(Entity entity) {
+    if (isAlive(entity)) {
+        destroyIndex(entity.index);
+    }
+}
+
+void EntityWorld::destroyIndex(uint32_t index) {
+    positions.remove(index);
+    velocities.remove(index);
+    sprites.remove(index);
+    colliders.remove(index);
+    pickups.remove(index);
+    hazards.remove(index);
+    homings.remove(index);
+    alive[index] = 0;
+    ++generations[index];
+    freeIndices.push_back(index);
+}
+
+bool EntityWorld::isAlive(Entity entity) const {
+    return entity.index < alive.size() && alive[entity.index] && generations[entity.index] == entity.generation;
+}
+
+Entity EntityWorld::getEntity(uint32_t index) const {
+    if (index >= alive.size() || !alive[index]) {
+        return NO_ENTITY;
+    }
+    return Entity{index, generations[index]};
+}
+
+size_t EntityWorld::size() const {
+    return alive.size() - freeIndices.size();
+}
+
+size_t EntityWorld::capacity() const {
+    return alive.size();
+}
+
+void EntityWorld::clear() {
+    positions.clear();
+    velocities.clear();
+    sprites.clear();
+    colliders.clear();
+    pickups.clear();
+    hazards.clear();
+    homings.clear();
+    
+    freeIndices.clear();
+    for (size_t i = alive.size(); i > 0; --i) {
+        uint32_t index = static_cast<uint32_t>(i - 1);
+        if (alive[index]) {
+            alive[index] = 0;
+            ++generations[index];
+        }
+        freeIndices.push_back(index);
+    }
+}
+
+void EntityWorld::saveState(StateWriter& writer) const {
+    // freeIndices starts as capacity-1 down to 0, so its bottom is usually still that
+    // untouched run; only the slots above it need saving
+    uint32_t capacity = static_cast<uint32_t>(alive.size());
+    uint32_t untouched = 0;
+    while (untouched < freeIndices.size() && freeIndices[untouched] == capacity - 1 - untouched) {
+        ++untouched;
+    }
+    uint32_t used = capacity - untouched;
+    writer.write(used);
+    writer.writeBytes(generations.data(), used * sizeof(uint32_t));
+    writer.writeBytes(alive.data(), used);
+    writer.write(static_cast<uint32_t>(freeIndices.size() - untouched));
+    writer.writeBytes(freeIndices.data() + untouched, (freeIndices.size() - untouched) * sizeof(uint32_t));
+    
+    positions.saveState(writer);
+    velocities.saveState(writer);
+    sprites.saveState(writer);
+    colliders.saveState(writer);
+    pickups.saveState(writer);
+    hazards.saveState(writer);
+    homings.saveState(writer);
+    writer.write(homingTargetX);
+    writer.write(homingTargetY);
+}
+
+bool EntityWorld::loadState(StateReader& reader) {
+    uint32_t capacity = static_cast<uint32_t>(alive.size());
+    uint32_t used, freeCount;
+    if (!reader.read(used) || used > capacity) {
+        reader.fail();
+        return false;
+    }
+    std::fill(generations.begin() + used, generations.end(), 0);
+    std::fill(alive.begin() + used, alive.end(), 0);
+    if (!reader.readBytes(generations.data(), used * sizeof(uint32_t)) ||
+        !reader.readBytes(alive.data(), used) || !reader.read(freeCount) || freeCount > used) {
+        reader.fail();
+        return false;
+    }
+    
+    freeIndices.clear();
+    for (uint32_t index = capacity; index > used; --index) {
+        freeIndices.push_back(index - 1);
+    }
+    for (uint32_t i = 0; i < freeCount; ++i) {
+        uint32_t index;
+        if (!reader.read(index) || index >= used) {
+            reader.fail();
+            return false;
+        }
+        freeIndices.push_back(index);
+    }
+    
+    return positions.loadState(reader) && velocities.loadState(reader) && sprites.loadState(reader) &&
+           colliders.loadState(reader) && pickups.loadState(reader) && hazards.loadState(reader) &&
+           homings.loadState(reader) && reader.read(homingTargetX) && reader.read(homingTargetY);
+}
+
+ComponentArray<Position>& EntityWorld::getPositions() {
+    return positions;
+}
+
+ComponentArray<Velocity>& EntityWorld::getVelocities() {
+    return velocities;
+}
+
+ComponentArray<Sprite>& EntityWorld::getSprites() {
+    return sprites;
+}
+
+ComponentArray<Collider>& EntityWorld::getColliders() {
+    return colliders;
+}
+
+ComponentArray<Pickup>& EntityWorld::getPickups() {
+    return pickups;
+}
+
+ComponentArray<Hazard>& EntityWorld::getHazards() {
+    return hazards;
+}
+
+ComponentArray<Homing>& EntityWorld::getHomings() {
+    return homings;
+}
+
+const ComponentArray<Position>& EntityWorld::getPositions() const {
+    return positions;
+}
+
+const ComponentArray<Velocity>& EntityWorld::getVelocities() const {
+    return velocities;
+}
+
+const ComponentArray<Collider>& EntityWorld::getColliders() const {
+    return colliders;
+}
+
+const ComponentArray<Pickup>& EntityWorld::getPickups() const {
+    return pickups;
+}
+
+const ComponentArray<Hazard>& EntityWorld::getHazards() const {
+    return hazards;
+}
+
+void EntityWorld::setHomingTarget(float x, float y) {
+    homingTargetX = x;
+    homingTargetY = y;
+}
+
+int EntityWorld::registerTexture(const std::string& id) {
+    for (size_t i = 0; i < textureIDs.size(); ++i) {
+        if (textureIDs[i] == id) {
+            return static_cast<int>(i);
+        }
+    }
+    textureIDs.push_back(id);
+    textures.push_back(nullptr);
+    return static_cast<int>(textureIDs.size() - 1);
+}
+
+void EntityWorld::update(float scrollDistance) {
+    homingSystem();
+    moveSystem(scrollDistance);
+    bounceSystem();
+    animationSystem();
+    despawnSystem();
+}
+
+void EntityWorld::moveSystem(float scrollDistance) {
+    // Everything scrolls with the map
+    Position* position = positions.data();
+    for (size_t i = 0, count = positions.size(); i < count; ++i) {
+        position[i].y += scrollDistance;
+    }
+    
+    // Then moves on its own
+    const Velocity* velocity = velocities.data();
+    const uint32_t* owners = velocities.entities();
+    for (size_t i = 0, count = velocities.size(); i < count; ++i) {
+        Position* moved = positions.get(owners[i]);
+        if (moved) {
+            moved->x += velocity[i].x;
+            moved->y += velocity[i].y;
+        }
+    }
+}
+
+void EntityWorld::homingSystem() {
+    // Point velocity straight at the target
+    const Homing* homing = homings.data();
+    const uint32_t* owners = homings.entities();
+    for (size_t i = 0, count = homings.size(); i < count; ++i) {
+        const Position* position = positions.get(owners[i]);
+        Velocity* velocity = velocities.get(owners[i]);
+        const Sprite* sprite = sprites.get(owners[i]);
+        if (!position || !velocity) {
+            continue;
+        }
+        float halfWidth = sprite ? sprite->width * 0.5f : 0.0f;
+        float halfHeight = sprite ? sprite->height * 0.5f : 0.0f;
+        float dx = homingTargetX - (position->x + halfWidth);
+        float dy = homingTargetY - (position->y + halfHeight);
+        float distance = std::sqrt(dx * dx + dy * dy);
+        if (distance > homing[i].speed) {
+            velocity->x = dx / distance * homing[i].speed;
+            velocity->y = dy / distance * homing[i].speed;
+        } else {
+            velocity->x = dx;
+            velocity->y = dy;
+        }
+    }
+}
+
+void EntityWorld::bounceSystem() {
+    // Keep colliders on screen horizontally by reflecting their velocity
+    const Collider* collider = colliders.data();
+    const uint32_t* owners = colliders.entities();
+    for (size_t i = 0, count = colliders.size(); i < count; ++i) {
+        Velocity* velocity = velocities.get(owners[i]);
+        Position* position = positions.get(owners[i]);
+        if (!velocity || !position) {
+            continue;
+        }
+        float left = position->x + collider[i].offsetX;
+        float right = left + collider[i].width;
+        if ((left < 0.0f && velocity->x < 0.0f) || (right > SCREEN_WIDTH && velocity->x > 0.0f)) {
+            velocity->x = -velocity->x;
+        }
+    }
+}
+
+void EntityWorld::animationSystem() {
+    // Same timing as GameObject::update
+    Sprite* sprite = sprites.data();
+    for (size_t i = 0, count = sprites.size(); i < count; ++i) {
+        if (++sprite[i].frameCounter > sprite[i].animationSpeed) {
+            sprite[i].frameCounter = 0;
+            sprite[i].frame = sprite[i].frameCount > 0 ? (sprite[i].frame + 1) % sprite[i].frameCount : 0;
+        }
+    }
+}
+
+void EntityWorld::despawnSystem() {
+    doomed.clear();
+    const Position* position = positions.data();
+    const uint32_t* owners = positions.entities();
+    for (size_t i = 0, count = positions.size(); i < count; ++i) {
+        if (position[i].y > ENTITY_DESPAWN_Y) {
+            doomed.push_back(owners[i]);
+        }
+    }
+    // Removal reorders the arrays, so it waits until the walk is done
+    for (uint32_t index : doomed) {
+        destroyIndex(index);
+    }
+}
+
+void EntityWorld::render(SDL_Renderer* renderer) const {
+    if (sprites.size() == 0) {
+        return;
+    }
+    
+    // One lookup per texture rather than per sprite
+    for (size_t i = 0; i < textureIDs.size(); ++i) {
+        textures[i] = TheTextureManager::Instance()->findTexture(textureIDs[i]);
+    }
+    
+    FrameArena* arena = TheFrameArena::Instance();
+    size_t arenaMarker = arena->mark();
+    RenderCommand* commands = arena->allocateArray<RenderCommand>(sprites.size());
+    if (!commands) {
+        return;
+    }
+    
+    const Sprite* sprite = sprites.data();
+    const uint32_t* owners = sprites.entities();
+    size_t count = 0;
+    for (size_t i = 0; i < sprites.size(); ++i) {
+        const Position* position = positions.get(owners[i]);
+        SDL_Texture* texture = (sprite[i].texture >= 0 && sprite[i].texture < static_cast<int>(textures.size()))
+                                   ? textures[sprite[i].texture] : nullptr;
+        if (!position || !texture) {
+            continue;
+        }
+        
+        RenderCommand& command = commands[count++];
+        command.texture = texture;
+        command.srcRect = {sprite[i].width * sprite[i].frame, 0, sprite[i].width, sprite[i].height};
+        command.destRect = {static_cast<int>(position->x), static_cast<int>(position->y), sprite[i].width, sprite[i].height};
+    }
+    
+    TheTextureManager::Instance()->submit(commands, count, renderer);
+    arena->rewind(arenaMarker);
+}
@@ -0,0 +1,248 @@
+#ifndef ENTITIES_H
+#define ENTITIES_H
+
+#include <SDL2/SDL.h>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "constants.h"
+#include "texturemanager.h"
+#include "serialize.h"
+
+// Identifies an entity. Slots are recycled, so the generation tells a destroyed
+// entity apart from a newer one in the same slot.
+struct Entity {
+    uint32_t index;
+    uint32_t generation;
+};
+
+const Entity NO_ENTITY = {UINT32_MAX, 0};
+
+// Components. Each type is stored in its own dense array (see ComponentArray).
+struct Position {
+    float x;                // Top-left corner in screen space, like the map's cells
+    float y;
+};
+
+struct Velocity {
+    float x;                // Pixels per tick, on top of the map's scrolling
+    float y;
+};
+
+struct Sprite {
+    int texture;            // Slot from EntityWorld::registerTexture
+    int width;              // Drawn size, also the sprite sheet frame size
+    int height;
+    int frame;
+    int frameCount;
+    int animationSpeed;     // Ticks per frame, like GameObject
+    int frameCounter;
+};
+
+struct Collider {
+    int offsetX;            // Box relative to Position
+    int offsetY;
+    int width;
+    int height;
+};
+
+struct Pickup {
+    int value;              // Points for collecting it
+};
+
+struct Hazard {};           // Kills the player on contact
+
+struct Homing {
+    float speed;            // Pixels per tick towards the homing target
+};
+
+// Packed storage for one component type. Components sit in dense with no holes, in
+// no particular order; sparse maps an entity index to its slot. Removing swaps the
+// last component into the hole, so systems can always walk dense front to back.
+template <typename T>
+class ComponentArray {
+private:
+    std::vector<T> dense;
+    std::vector<uint32_t> owners;   // Entity index of each dense slot
+    std::vector<uint32_t> sparse;   // Entity index -> dense slot
+
+public:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    explicit ComponentArray(size_t capacity) : sparse(capacity, NONE) {
+        dense.reserve(capacity);
+        owners.reserve(capacity);
+    }
+
+    T& add(Entity entity, const T& value) {
+        uint32_t slot = sparse[entity.index];
+        if (slot != NONE) {
+            dense[slot] = value;
+            return dense[slot];
+        }
+        sparse[entity.index] = static_cast<uint32_t>(dense.size());
+        dense.push_back(value);
+        owners.push_back(entity.index);
+        return dense.back();
+    }
+
+    void remove(uint32_t index) {
+        uint32_t slot = sparse[index];
+        if (slot == NONE) {
+            return;
+        }
+        uint32_t last = static_cast<uint32_t>(dense.size() - 1);
+        dense[slot] = dense[last];
+        owners[slot] = owners[last];
+        sparse[owners[slot]] = slot;
+        dense.pop_back();
+        owners.pop_back();
+        sparse[index] = NONE;
+    }
+
+    bool has(uint32_t index) const {
+        return sparse[index] != NONE;
+    }
+
+    // Component of the entity at index, or nullptr
+    T* get(uint32_t index) {
+        uint32_t slot = sparse[index];
+        return slot != NONE ? &dense[slot] : nullptr;
+    }
+
+    const T* get(uint32_t index) const {
+        uint32_t slot = sparse[index];
+        return slot != NONE ? &dense[slot] : nullptr;
+    }
+
+    size_t size() const { return dense.size(); }
+    T* data() { return dense.data(); }
+    const T* data() const { return dense.data(); }
+    // Entity index owning each component in data()
+    const uint32_t* entities() const { return owners.data(); }
+
+    void clear() {
+        for (uint32_t index : owners) {
+            sparse[index] = NONE;
+        }
+        dense.clear();
+        owners.clear();
+    }
+
+    // Dense order is kept, so systems visit components in the same order after loading.
+    // Tag components have no data; their byte is padding and isn't saved.
+    void saveState(StateWriter& writer) const {
+        writer.write(static_cast<uint32_t>(dense.size()));
+        writer.writeBytes(owners.data(), owners.size() * sizeof(uint32_t));
+        if (!std::is_empty<T>::value) {
+            writer.writeBytes(dense.data(), dense.size() * sizeof(T));
+        }
+    }
+
+    bool loadState(StateReader& reader) {
+        clear();
+        uint32_t count;
+        if (!reader.read(count) || count > sparse.size()) {
+            reader.fail();
+            return false;
+        }
+        owners.resize(count);
+        dense.resize(count);
+        if (!reader.readBytes(owners.data(), count * sizeof(uint32_t)) ||
+            (!std::is_empty<T>::value && !reader.readBytes(dense.data(), count * sizeof(T)))) {
+            owners.clear();
+            dense.clear();
+            return false;
+        }
+        for (uint32_t slot = 0; slot < count; ++slot) {
+            if (owners[slot] >= sparse.size() || sparse[owners[slot]] != NONE) {
+                reader.fail();
+                clear();
+                return false;
+            }
+            sparse[owners[slot]] = slot;
+        }
+        return true;
+    }
+};
+
+// Data-oriented store for dynamic objects (moving obstacles, pickups, effects).
+// All storage is reserved for capacity entities up front, so creating and
+// destroying entities during play never allocates. Systems walk the packed
+// component arrays linearly.
+class EntityWorld {
+private:
+    std::vector<uint32_t> generations;
+    std::vector<uint8_t> alive;
+    std::vector<uint32_t> freeIndices;
+    std::vector<uint32_t> doomed;       // Scratch for entities removed by update()
+
+    ComponentArray<Position> positions;
+    ComponentArray<Velocity> velocities;
+    ComponentArray<Sprite> sprites;
+    ComponentArray<Collider> colliders;
+    ComponentArray<Pickup> pickups;
+    ComponentArray<Hazard> hazards;
+    ComponentArray<Homing> homings;
+    float homingTargetX;
+    float homingTargetY;
+
+    std::vector<std::string> textureIDs;
+    mutable std::vector<SDL_Texture*> textures; // Resolved once per render()
+
+    void destroyIndex(uint32_t index);
+    void homingSystem();
+    void moveSystem(float scrollDistance);
+    void bounceSystem();
+    void animationSystem();
+    void despawnSystem();
+
+public:
+    explicit EntityWorld(size_t capacity = MAX_ENTITIES);
+
+    EntityWorld(const EntityWorld&) = delete;
+    EntityWorld& operator=(const EntityWorld&) = delete;
+
+    // New entity with no components; NO_ENTITY when the world is full
+    Entity create();
+    void destroy(Entity entity);
+    bool isAlive(Entity entity) const;
+    Entity getEntity(uint32_t index) const;  // Current handle for a live slot
+    size_t size() const;
+    size_t capacity() const;
+    void clear();
+
+    // Slot for a texture ID, to put in Sprite::texture
+    int registerTexture(const std::string& id);
+
+    ComponentArray<Position>& getPositions();
+    ComponentArray<Velocity>& getVelocities();
+    ComponentArray<Sprite>& getSprites();
+    ComponentArray<Collider>& getColliders();
+    ComponentArray<Pickup>& getPickups();
+    ComponentArray<Hazard>& getHazards();
+    ComponentArray<Homing>& getHomings();
+    const ComponentArray<Position>& getPositions() const;
+    const ComponentArray<Velocity>& getVelocities() const;
+    const ComponentArray<Collider>& getColliders() const;
+    const ComponentArray<Pickup>& getPickups() const;
+    const ComponentArray<Hazard>& getHazards() const;
+    
+    // Point that Homing entities steer towards, e.g. the player's centre
+    void setHomingTarget(float x, float y);
+    
+    // Entity slots, free list and every component array. Only slots that have been
+    // handed out are written, so a world with a few live entities saves in a few hundred bytes.
+    void saveState(StateWriter& writer) const;
+    // On failure the world is left partly loaded; clear() it before use
+    bool loadState(StateReader& reader);
+
+    // One game tick: steer homing entities, move by velocity plus scrollDistance,
+    // bounce colliders off the screen sides, animate sprites and remove entities
+    // that have left the bottom of the screen
+    void update(float scrollDistance = SCROLL_SPEED);
+    void render(SDL_Renderer* renderer) const;
+};
+
+#endif // ENTITIES_H
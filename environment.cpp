@@ -0,0 +1,266 @@
+#include "environment.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+// Player start position, same as a windowed game
+static const int PLAYER_START_X = SCREEN_WIDTH / 2 - PLAYER_WIDTH / 2;
+static const int PLAYER_START_Y = SCREEN_HEIGHT - PLAYER_HEIGHT - 50;
+
+VecEnv::Env::Env(uint32_t envSeed)
+    : map(envSeed),
+      player(PLAYER_START_X, PLAYER_START_Y),
+      seed(envSeed),
+      episode(0)
+{}
+
+VecEnv::VecEnv(int numEnvs, int numThreads)
+    : job{},
+      generation(0),
+      pendingWorkers(0),
+      stopping(false) {
+    envs.reserve(numEnvs);
+    for (int i = 0; i < numEnvs; ++i) {
+        envs.push_back(std::make_unique<Env>(static_cast<uint32_t>(i)));
+    }
+
+    if (numThreads <= 0) {
+        numThreads = static_cast<int>(std::thread::hardware_concurrency());
+    }
+    numThreads = std::max(1, std::min(numThreads, std::max(1, numEnvs)));
+
+    // The calling thread runs shard 0, workers take the rest
+    for (int shard = 1; shard < numThreads; ++shard) {
+        workers.emplace_back(&VecEnv::workerLoop, this, shard);
+    }
+}
+
+VecEnv::~VecEnv() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    startCondition.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+int VecEnv::size() const {
+    return static_cast<int>(envs.size());
+}
+
+int VecEnv::threadCount() const {
+    return static_cast<int>(workers.size()) + 1;
+}
+
+void VecEnv::reset(const uint32_t* seeds, float* observations) {
+    Job work = {};
+    work.seeds = seeds;
+    work.observations = observations;
+    dispatch(work);
+}
+
+void VecEnv::step(const uint8_t* actions, float* observations, float* rewards, uint8_t* dones) {
+    Job work = {};
+    work.actions = actions;
+    work.observations = observations;
+    work.rewards = rewards;
+    work.dones = dones;
+    dispatch(work);
+}
+
+void VecEnv::saveState(int index, std::vector<uint8_t>& out) const {
+    const Env& env = *envs[index];
+    out.clear();
+    StateWriter writer(out);
+    writer.write(env.seed);
+    writer.write(env.episode);
+    env.player.saveState(writer);
+    env.map.saveState(writer);
+}
+
+bool VecEnv::loadState(int index, const uint8_t* data, size_t size, float* observation) {
+    Env& env = *envs[index];
+    StateReader reader(data, size);
+    bool loaded = reader.read(env.seed) && reader.read(env.episode) && env.player.loadState(reader) &&
+                  env.map.loadState(reader) && reader.ok();
+    if (!loaded) {
+        // Don't leave a half-loaded map behind
+        resetEnv(env, env.seed);
+    }
+    if (observation) {
+        writeObservation(env, observation);
+    }
+    return loaded;
+}
+
+void VecEnv::dispatch(const Job& work) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = work;
+        pendingWorkers = static_cast<int>(workers.size());
+        ++generation;
+    }
+    startCondition.notify_all();
+
+    runShard(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    doneCondition.wait(lock, [this]() { return pendingWorkers == 0; });
+}
+
+void VecEnv::workerLoop(int shard) {
+    uint64_t seenGeneration = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            startCondition.wait(lock, [&]() { return stopping || generation != seenGeneration; });
+            if (stopping) {
+                return;
+            }
+            seenGeneration = generation;
+        }
+
+        runShard(shard);
+
+        bool last;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            last = (--pendingWorkers == 0);
+        }
+        if (last) {
+            doneCondition.notify_one();
+        }
+    }
+}
+
+void VecEnv::runShard(int shard) {
+    // Contiguous ranges keep each thread's envs and output slices together in memory
+    int count = size();
+    int shards = threadCount();
+    int begin = static_cast<int>(static_cast<int64_t>(count) * shard / shards);
+    int end = static_cast<int>(static_cast<int64_t>(count) * (shard + 1) / shards);
+
+    for (int i = begin; i < end; ++i) {
+        Env& env = *envs[i];
+        if (job.seeds) {
+            resetEnv(env, job.seeds[i]);
+        } else {
+            stepEnv(env, static_cast<EnvAction>(job.actions[i]), job.rewards[i], job.dones[i]);
+        }
+        writeObservation(env, job.observations + static_cast<size_t>(i) * OBS_SIZE);
+    }
+}
+
+void VecEnv::resetEnv(Env& env, uint32_t seed) {
+    env.seed = seed;
+    env.episode = 0;
+    env.map.reset(seed);
+    env.player.reset(PLAYER_START_X, PLAYER_START_Y);
+}
+
+void VecEnv::stepEnv(Env& env, EnvAction action, float& reward, uint8_t& done) {
+    // Same order as Game: input, then player and map update, then collision
+    if (action == EnvAction::LEFT) {
+        env.player.moveLeft();
+    } else if (action == EnvAction::RIGHT) {
+        env.player.moveRight();
+    }
+
+    env.player.update();
+    env.map.update();
+
+    CollisionResult result;
+    env.map.queryCollisions(&env.player.getRect(), 1, &result);
+    int points = env.map.applyPickups(result);
+    env.player.addScore(points);
+
+    reward = static_cast<float>(points) - (result.hitObstacle ? ENV_CRASH_PENALTY : 0.0f);
+    done = (result.hitObstacle || result.reachedFinish) ? 1 : 0;
+
+    if (done) {
+        // Next episode gets a distinct but reproducible map
+        uint32_t episode = env.episode + 1;
+        env.map.reset(env.seed + episode * 0x9E3779B9u);
+        env.player.reset(PLAYER_START_X, PLAYER_START_Y);
+        env.episode = episode;
+    }
+}
+
+void VecEnv::writeObservation(const Env& env, float* out) const {
+    const SDL_Rect& rect = env.player.getRect();
+
+    // Rows ending at the one under the player's feet
+    int bottomY = rect.y + rect.h - 1;
+    for (int r = 0; r < OBS_ROWS; ++r) {
+        const RowOccupancy* row = env.map.getRowAt(bottomY - (OBS_ROWS - 1 - r) * GRID_SIZE);
+        float* cells = out + r * GRID_COLS;
+        for (int col = 0; col < GRID_COLS; ++col) {
+            ObsCell cell = ObsCell::EMPTY;
+            if (row) {
+                if (row->finish) {
+                    cell = ObsCell::FINISH;
+                } else if ((row->obstacles >> col) & 1u) {
+                    cell = ObsCell::OBSTACLE;
+                } else if ((row->coins >> col) & 1u) {
+                    cell = ObsCell::COIN;
+                }
+            }
+            cells[col] = static_cast<float>(cell);
+        }
+    }
+
+    out[OBS_ROWS * GRID_COLS] = static_cast<float>(rect.x) / (SCREEN_WIDTH - PLAYER_WIDTH);
+    out[OBS_ROWS * GRID_COLS + 1] = static_cast<float>(env.player.getScore());
+}
+
+bool benchmarkVecEnv(int steps) {
+    if (steps <= 0) {
+        return false;
+    }
+    std::vector<uint32_t> seeds(ENV_BENCHMARK_ENVS);
+    std::vector<uint8_t> actions(ENV_BENCHMARK_ENVS);
+    std::vector<float> observations(static_cast<size_t>(ENV_BENCHMARK_ENVS) * OBS_SIZE);
+    std::vector<float> rewards(ENV_BENCHMARK_ENVS);
+    std::vector<uint8_t> dones(ENV_BENCHMARK_ENVS);
+    for (int i = 0; i < ENV_BENCHMARK_ENVS; ++i) {
+        seeds[i] = static_cast<uint32_t>(i);
+    }
+
+    std::cout << "Environment benchmark: " << ENV_BENCHMARK_ENVS << " environments, " << steps
+              << " steps" << std::endl;
+    int threadCounts[2] = {1, 0};
+    double singleThreadRate = 0.0;
+    for (int threads : threadCounts) {
+        VecEnv env(ENV_BENCHMARK_ENVS, threads);
+        env.reset(seeds.data(), observations.data());
+
+        // The same pseudo-random actions for every thread count
+        uint32_t random = 12345;
+        auto start = std::chrono::steady_clock::now();
+        for (int step = 0; step < steps; ++step) {
+            for (uint8_t& action : actions) {
+                random = random * 1664525u + 1013904223u;
+                action = static_cast<uint8_t>((random >> 8) % 3);
+            }
+            env.step(actions.data(), observations.data(), rewards.data(), dones.data());
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double envSteps = static_cast<double>(steps) * ENV_BENCHMARK_ENVS;
+        double rate = seconds > 0.0 ? envSteps / seconds : 0.0;
+        std::cout << "  " << env.threadCount() << (env.threadCount() == 1 ? " thread:  " : " threads: ")
+                  << rate << " steps/s";
+        if (threads == 1) {
+            singleThreadRate = rate;
+        }
+        else if (env.threadCount() == 1) {
+            std::cout << " (only one hardware thread, no multi-core figure)";
+        }
+        else if (singleThreadRate > 0.0) {
+            std::cout << " (" << rate / singleThreadRate << "x one thread)";
+        }
+        std::cout << std::endl;
+    }
+    return true;
+}
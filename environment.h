@@ -0,0 +1,107 @@
+#ifndef ENVIRONMENT_H
+#define ENVIRONMENT_H
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include "constants.h"
+#include "gameobject.h"
+#include "gamemap.h"
+
+// Observation layout for one environment, written contiguously:
+//   OBS_ROWS x GRID_COLS cell codes (see ObsCell), nearest row to the player last
+//   player x, normalized to 0..1
+//   player score
+const int OBS_ROWS                          = 8;
+const int OBS_SIZE                          = OBS_ROWS * GRID_COLS + 2;
+const float ENV_CRASH_PENALTY               = 100.0f;
+const int ENV_BENCHMARK_ENVS                = 256;      // Environments stepped together by --bench-env
+const int ENV_BENCHMARK_STEPS               = 2000;     // Default number of batched steps for --bench-env
+
+enum class ObsCell {
+    EMPTY = 0,
+    OBSTACLE = 1,
+    COIN = 2,
+    FINISH = 3
+};
+
+enum class EnvAction : uint8_t {
+    NONE = 0,
+    LEFT = 1,
+    RIGHT = 2
+};
+
+// Headless batch of independent GameMap + Player runs for bots and training.
+// Every call advances all environments by one game tick, split across worker threads,
+// and writes straight into caller-owned arrays:
+//   observations  size() * OBS_SIZE floats
+//   actions       size() EnvAction values
+//   rewards/dones size() entries
+// An environment that crashes or finishes reports done and restarts on its next seed.
+class VecEnv {
+private:
+    struct Env {
+        GameMap map;
+        Player player;
+        uint32_t seed;
+        uint32_t episode;
+
+        explicit Env(uint32_t envSeed);
+    };
+
+    // Work published to the worker threads for one call
+    struct Job {
+        const uint32_t* seeds;
+        const uint8_t* actions;
+        float* observations;
+        float* rewards;
+        uint8_t* dones;
+    };
+
+    std::vector<std::unique_ptr<Env>> envs;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable startCondition;
+    std::condition_variable doneCondition;
+    Job job;
+    uint64_t generation;    // Bumped for every published job
+    int pendingWorkers;
+    bool stopping;
+
+    void workerLoop(int shard);
+    void runShard(int shard);
+    void dispatch(const Job& work);
+
+    void resetEnv(Env& env, uint32_t seed);
+    void stepEnv(Env& env, EnvAction action, float& reward, uint8_t& done);
+    void writeObservation(const Env& env, float* out) const;
+
+public:
+    // numThreads <= 0 uses one thread per hardware core
+    explicit VecEnv(int numEnvs, int numThreads = 0);
+    ~VecEnv();
+
+    VecEnv(const VecEnv&) = delete;
+    VecEnv& operator=(const VecEnv&) = delete;
+
+    int size() const;
+    int threadCount() const;
+
+    void reset(const uint32_t* seeds, float* observations);
+    void step(const uint8_t* actions, float* observations, float* rewards, uint8_t* dones);
+
+    // Branching: snapshot one environment, then load the snapshot into any environment
+    // to explore from the same state. Not to be called during reset() or step().
+    void saveState(int index, std::vector<uint8_t>& out) const;    // Replaces out
+    // Writes the restored environment's observation (OBS_SIZE floats) when observation isn't null
+    bool loadState(int index, const uint8_t* data, size_t size, float* observation);
+};
+
+// Step ENV_BENCHMARK_ENVS environments with random actions for steps batched calls, on
+// one thread and then on every core, and print environment steps per second for each
+bool benchmarkVecEnv(int steps);
+
+#endif // ENVIRONMENT_H
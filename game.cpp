@@ -1,5 +1,11 @@
 #include "game.h"
+#include "drawstats.h"
+#include "perfgate.h"
+#include "autopilot.h"
 #include "constants.h"
+#include "jobsystem.h"
+#include "audio.h"
+#include <algorithm>
 #include <iostream>
 #include <SDL2/SDL_ttf.h>
 
@@ -16,10 +22,19 @@ Game::~Game() {
 }
 
 bool Game::init(const char* title, int xpos, int ypos, int width, int height, bool fullscreen) {
+    startupPhases.clear();
+    phaseStart = SDL_GetPerformanceCounter();
+    Uint64 initStart = phaseStart;
+    
     int flags = 0;
     if (fullscreen) {
         flags = SDL_WINDOW_FULLSCREEN;
     }
+    if (headless) {
+        flags |= SDL_WINDOW_HIDDEN;
+        // Nothing is shown, so no display is needed; SDL_VIDEODRIVER still wins if set
+        SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+    }
 
     if (SDL_Init(SDL_INIT_VIDEO) < 0) {
         std::cerr << "SDL could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
@@ -33,62 +48,448 @@ bool Game::init(const char* title, int xpos, int ypos, int width, int height, bo
     }
 
     renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    if (renderer == nullptr) {
+        // No GPU, or SDL_VIDEODRIVER=dummy for headless runs
+        std::cerr << "No accelerated renderer, using software: " << SDL_GetError() << std::endl;
+        renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE);
+    }
     if (renderer == nullptr) {
         std::cerr << "Renderer could not be created! SDL_Error: " << SDL_GetError() << std::endl;
         return false;
     }
+    
+    // Sized for the largest render scale; smaller scales use its top-left corner
+    sceneTarget = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET,
+                                    SCREEN_WIDTH, SCREEN_HEIGHT);
+    if (sceneTarget) {
+        SDL_SetTextureScaleMode(sceneTarget, SDL_ScaleModeLinear);
+    } else {
+        std::cerr << "No render target, drawing at full resolution: " << SDL_GetError() << std::endl;
+    }
+    markStartupPhase("SDL and window");
+
+    if (!TheJobSystem::Instance()->init(jobWorkers)) {
+        std::cerr << "JobSystem initialization failed!" << std::endl;
+        return false;
+    }
 
     if (!TheTextureManager::Instance()->init()) {
         std::cerr << "TextureManager initialization failed!" << std::endl;
         return false;
     }
 
-    if (!TheTextureManager::Instance()->loadTexture(PLAYER_TEXTURE_PATH, PLAYER_TEXTURE_ID, renderer) ||
-        !TheTextureManager::Instance()->loadTexture(OBSTACLE_TEXTURE_PATH, OBSTACLE_TEXTURE_ID, renderer) ||
-        !TheTextureManager::Instance()->loadTexture(COIN_TEXTURE_PATH, COIN_TEXTURE_ID, renderer) ||
-        !TheTextureManager::Instance()->loadTexture(FINISH_PATH, FINISH_TEXTURE_ID, renderer) ||
-        !TheTextureManager::Instance()->loadTexture(BACKGROUND_PATH, BACKGROUND_TEXTURE_ID, renderer) ||
-        !TheTextureManager::Instance()->loadTexture(MENU_BACKGROUND_PATH, MENU_BACKGROUND_ID, renderer) ||
-        !TheTextureManager::Instance()->loadTexture(ABOUT_BACKGROUND_PATH, ABOUT_BACKGROUND_ID, renderer)) {
+    // Pre-decoded pack is optional; without it images are decoded from assets/
+    if (TheTextureManager::Instance()->openPack(ASSET_PACK_PATH)) {
+        std::cout << "Using asset pack " << ASSET_PACK_PATH << std::endl;
+    }
+    markStartupPhase("Job system and asset pack");
+    
+    if (cpuRenderer) {
+        // Images have to be kept as they load, so this comes before any texture
+        TheTextureManager::Instance()->setKeepCpuImages(true);
+        rasterizer = std::make_unique<SoftwareRasterizer>(SCREEN_WIDTH, SCREEN_HEIGHT);
+        std::cout << "CPU renderer using " << getRasterKernelName(rasterizer->getKernel()) << std::endl;
+    }
+
+    // Register everything, but only load what the main menu shows; the rest loads on first use
+    std::vector<TextureRequest> textures;
+    std::vector<std::string> startTextures = getScreenTextures(menuState);
+    for (const TextureRequest& request : getTextureRequests()) {
+        TheTextureManager::Instance()->registerTexture(request);
+        if (std::find(startTextures.begin(), startTextures.end(), request.id) != startTextures.end()) {
+            textures.push_back(request);
+        }
+    }
+    auto onProgress = [this](int loaded, int total) { renderLoadingScreen(loaded, total); };
+    if (!TheTextureManager::Instance()->loadTextures(textures, renderer, onProgress)) {
         std::cerr << "Failed to load textures!" << std::endl;
         return false;
     }
+    for (const std::string& id : startTextures) {
+        TheTextureManager::Instance()->acquire(id, renderer);
+    }
+    markStartupPhase("Textures");
 
     if (TTF_Init() == -1) {
         std::cerr << "TTF_Init Error: " << TTF_GetError() << std::endl;
         return false;
     }
-    font = TTF_OpenFont("assets/arial.ttf", 24);
+    font = TheTextureManager::Instance()->openFont(FONT_PATH, 24);
     if (!font) {
         std::cerr << "Font Load Error: " << TTF_GetError() << std::endl;
         return false;
     }
+    if (!createHudText()) {
+        return false;
+    }
+    markStartupPhase("Fonts");
 
+    // The game still runs without sound if no audio device can be opened
+    if (!headless && !TheAudioMixer::Instance()->init(audioDriver.empty() ? nullptr : audioDriver.c_str())) {
+        std::cerr << "Continuing without audio" << std::endl;
+    }
+    TheAudioMixer::Instance()->setMusicEnabled(true);
+    markStartupPhase("Audio");
+
+    entities = std::make_unique<EntityWorld>();
+    broadphase = std::make_unique<Broadphase>();
+    obstacleSlot = entities->registerTexture(OBSTACLE_TEXTURE_ID);
+    coinSlot = entities->registerTexture(COIN_TEXTURE_ID);
+    
+    particles = std::make_unique<ParticleSystem>();
+    ParticleSystem::createParticleTexture(PARTICLE_TEXTURE_ID, renderer);
+    coinEmitter = particles->addEmitter(PARTICLE_TEXTURE_ID, MAX_COIN_PARTICLES, SDL_Color{255, 215, 0, 255}, 8.0f, 0.05f);
+    crashEmitter = particles->addEmitter(PARTICLE_TEXTURE_ID, MAX_CRASH_PARTICLES, SDL_Color{255, 90, 30, 255}, 10.0f, 0.15f);
+    // Created once; runs reset them in place
+    uint32_t seed = std::random_device()();
     player = std::make_unique<Player>(SCREEN_WIDTH / 2 - PLAYER_WIDTH / 2, SCREEN_HEIGHT - PLAYER_HEIGHT - 50);
     player->setTextureID(PLAYER_TEXTURE_ID);
-    gameMap = std::make_unique<GameMap>();
+    gameMap = std::make_unique<GameMap>(seed);
+    gameMap->setParallel(true);
+    nextMap = std::make_unique<GameMap>(seed);
+    nextMap->setParallel(true);
+    startRun(seed);
+    markStartupPhase("Player and map");
+
+    // Only the first screen's menu is built now
+    getMenu(menuState);
+    markStartupPhase("Main menu");
+
+    for (const StartupPhase& phase : startupPhases) {
+        std::cout << "Startup " << phase.name << ": " << phase.ms << " ms" << std::endl;
+    }
+    std::cout << "Main menu interactive after "
+              << (SDL_GetPerformanceCounter() - initStart) * 1000.0 / SDL_GetPerformanceFrequency() << " ms" << std::endl;
 
-    initMenus();
+    if (!capturePath.empty()) {
+        // Headless runs aren't real time, so they can wait for the writer and keep every frame
+        capture.setWaitForBuffers(headless);
+        if (!capture.start(capturePath, renderer)) {
+            return false;
+        }
+    }
 
     running = true;
     return true;
 }
 
-void Game::initMenus() {
-    mainMenu = std::make_unique<MainMenu>(this);
-    mainMenu->setBackground(MENU_BACKGROUND_ID);
+bool Game::createHudText() {
+    SDL_Color textColor = {255, 255, 255, 255};
+    bool created = createTextSprite(font, "Score: ", textColor, scoreLabel) &&
+                   createTextSprite(font, "Distance: ", textColor, distanceLabel);
+    for (int digit = 0; digit < 10 && created; ++digit) {
+        char text[2] = {static_cast<char>('0' + digit), '\0'};
+        created = createTextSprite(font, text, textColor, digitSprites[digit]);
+    }
     
-    pauseMenu = std::make_unique<PauseMenu>(this);
-    pauseMenu->setBackground(MENU_BACKGROUND_ID);
+    const char* statsLabels[STATS_TEXT_COUNT] = {"Cells: ", "Arena KB: ", "Textures KB: ", "Allocs/frame: ", "Entities: ", "Particles: ",
+                                                "Input to apply ms: ", "Apply to present ms: ", "Input to present ms: ",
+                                                "Resolution: ", " x ", "  frame ms: ",
+                                                " p95 ",
+                                                " peak ",
+                                                " of "};
+    for (int i = 0; i < STATS_TEXT_COUNT && created; ++i) {
+        created = createTextSprite(font, statsLabels[i], textColor, statsText[i]);
+    }
     
-    gameOverMenu = std::make_unique<GameOverMenu>(this);
-    gameOverMenu->setBackground(MENU_BACKGROUND_ID);
+    TTF_Font* bigFont = TheTextureManager::Instance()->openFont(FONT_PATH, 36);
+    if (bigFont) {
+        SDL_Color messageColor = {0, 255, 0, 255};
+        created = created && createTextSprite(bigFont, "Level Complete! Press R to restart", messageColor,
+                                               levelCompleteText, true);
+        TTF_CloseFont(bigFont);
+    }
     
-    optionsMenu = std::make_unique<OptionsMenu>(this);
-    optionsMenu->setBackground(MENU_BACKGROUND_ID);
+    if (!created) {
+        std::cerr << "Failed to render HUD text: " << TTF_GetError() << std::endl;
+    }
+    return created;
+}
+
+bool Game::createTextSprite(TTF_Font* textFont, const char* text, SDL_Color color, TextSprite& sprite,
+                            bool blended) {
+    SDL_Surface* surface = blended ? TTF_RenderText_Blended(textFont, text, color)
+                                   : TTF_RenderText_Solid(textFont, text, color);
+    if (!surface) {
+        return false;
+    }
+    sprite.texture = SDL_CreateTextureFromSurface(renderer, surface);
+    sprite.width = surface->w;
+    sprite.height = surface->h;
+    SDL_FreeSurface(surface);
+    return sprite.texture != nullptr;
+}
+
+void Game::destroyHudText() {
+    TextSprite* sprites[] = {&scoreLabel, &distanceLabel, &levelCompleteText};
+    for (TextSprite* sprite : sprites) {
+        if (sprite->texture) {
+            SDL_DestroyTexture(sprite->texture);
+        }
+        *sprite = TextSprite{};
+    }
+    for (TextSprite& sprite : digitSprites) {
+        if (sprite.texture) {
+            SDL_DestroyTexture(sprite.texture);
+        }
+        sprite = TextSprite{};
+    }
+    for (TextSprite& sprite : statsText) {
+        if (sprite.texture) {
+            SDL_DestroyTexture(sprite.texture);
+        }
+        sprite = TextSprite{};
+    }
+}
+
+int Game::drawTextSprite(const TextSprite& sprite, int x, int y) {
+    if (sprite.texture) {
+        SDL_Rect destRect = {x, y, sprite.width, sprite.height};
+        countDrawCall();
+        SDL_RenderCopy(renderer, sprite.texture, nullptr, &destRect);
+    }
+    return x + sprite.width;
+}
+
+int Game::drawNumber(int value, int x, int y) {
+    // Drawn digit by digit from the pre-rendered glyphs
+    char text[16];
+    SDL_snprintf(text, sizeof(text), "%d", value);
+    for (const char* c = text; *c; ++c) {
+        if (*c >= '0' && *c <= '9') {
+            x = drawTextSprite(digitSprites[*c - '0'], x, y);
+        }
+    }
+    return x;
+}
+
+int Game::drawUsage(const AllocatorStats& stats, size_t unit, int x, int y) {
+    // "used peak N of M"
+    x = drawNumber(static_cast<int>(stats.used / unit), x, y);
+    x = drawNumber(static_cast<int>(stats.highWater / unit), drawTextSprite(statsText[STATS_PEAK], x, y), y);
+    return drawNumber(static_cast<int>(stats.capacity / unit), drawTextSprite(statsText[STATS_OF], x, y), y);
+}
+
+void Game::renderStatsOverlay() {
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 150);
+    SDL_Rect background = {10, 60, 680, 10 * 30 + 10};
+    countDrawCall();
+    SDL_RenderFillRect(renderer, &background);
+    
+    int x = 20;
+    int y = 65;
+    if (gameMap) {
+        drawUsage(gameMap->getCellPoolStats(), 1, drawTextSprite(statsText[STATS_CELLS], x, y), y);
+    }
+    y += 30;
+    drawUsage(TheFrameArena::Instance()->getStats(), 1024, drawTextSprite(statsText[STATS_ARENA], x, y), y);
+    y += 30;
+    drawNumber(static_cast<int>(TheTextureManager::Instance()->getResidentBytes() / 1024),
+               drawTextSprite(statsText[STATS_TEXTURES], x, y), y);
+    y += 30;
+    const FrameAllocations& frame = lastFrameAllocations;
+    drawNumber(static_cast<int>(frame.events.count + frame.update.count + frame.render.count),
+               drawTextSprite(statsText[STATS_ALLOCATIONS], x, y), y);
+    y += 30;
+    if (entities) {
+        int end = drawNumber(static_cast<int>(entities->size()), drawTextSprite(statsText[STATS_ENTITIES], x, y), y);
+        drawNumber(static_cast<int>(entities->capacity()), drawTextSprite(statsText[STATS_OF], end, y), y);
+    }
+    y += 30;
+    if (particles) {
+        drawNumber(static_cast<int>(particles->size()), drawTextSprite(statsText[STATS_PARTICLES], x, y), y);
+    }
+    y += 30;
+    drawLatency(inputLatency.getHistogram(LatencyStage::INPUT_TO_APPLY), statsText[STATS_INPUT_TO_APPLY], x, y);
+    y += 30;
+    drawLatency(inputLatency.getHistogram(LatencyStage::APPLY_TO_PRESENT), statsText[STATS_APPLY_TO_PRESENT], x, y);
+    y += 30;
+    drawLatency(inputLatency.getHistogram(LatencyStage::INPUT_TO_PRESENT), statsText[STATS_INPUT_TO_PRESENT], x, y);
+    y += 30;
+    int end = drawNumber(resolution.getWidth(), drawTextSprite(statsText[STATS_RESOLUTION], x, y), y);
+    end = drawNumber(resolution.getHeight(), drawTextSprite(statsText[STATS_BY], end, y), y);
+    drawNumber(static_cast<int>(resolution.getAverageFrameMs() + 0.5), drawTextSprite(statsText[STATS_FRAME_MS], end, y), y);
+}
+
+void Game::drawLatency(const LatencyHistogram& histogram, const TextSprite& label, int x, int y) {
+    // Median and 95th percentile, then one bar per millisecond bucket
+    x = drawNumber(static_cast<int>(histogram.getPercentile(0.5)), drawTextSprite(label, x, y), y);
+    drawNumber(static_cast<int>(histogram.getPercentile(0.95)), drawTextSprite(statsText[STATS_P95], x, y), y);
+    
+    uint32_t largest = histogram.getLargestBucket();
+    if (largest == 0) {
+        return;
+    }
+    const int barHeight = 24;
+    SDL_Rect* bars = TheFrameArena::Instance()->allocateArray<SDL_Rect>(LATENCY_BUCKETS);
+    if (!bars) {
+        return;
+    }
+    int barCount = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; ++i) {
+        int height = static_cast<int>(static_cast<uint64_t>(histogram.getBucket(i)) * barHeight / largest);
+        if (height > 0) {
+            bars[barCount++] = SDL_Rect{470 + i * 3, y + barHeight - height, 2, height};
+        }
+    }
+    SDL_SetRenderDrawColor(renderer, 120, 200, 255, 255);
+    countDrawCall();
+    SDL_RenderFillRects(renderer, bars, barCount);
+}
+
+void Game::markStartupPhase(const char* name) {
+    Uint64 now = SDL_GetPerformanceCounter();
+    startupPhases.push_back({name, (now - phaseStart) * 1000.0 / SDL_GetPerformanceFrequency()});
+    phaseStart = now;
+}
+
+const std::vector<StartupPhase>& Game::getStartupPhases() const {
+    return startupPhases;
+}
+
+void Game::renderLoadingScreen(int loaded, int total) {
+    // Keep the window responsive while images decode
+    SDL_PumpEvents();
     
-    aboutMenu = std::make_unique<AboutMenu>(this);
-    aboutMenu->setBackground(ABOUT_BACKGROUND_ID);
+    SDL_SetRenderDrawColor(renderer, 50, 50, 50, 255);
+    SDL_RenderClear(renderer);
+    
+    int barWidth = SCREEN_WIDTH / 2;
+    int barHeight = 30;
+    SDL_Rect frameRect = {(SCREEN_WIDTH - barWidth) / 2, (SCREEN_HEIGHT - barHeight) / 2, barWidth, barHeight};
+    SDL_Rect fillRect = {frameRect.x, frameRect.y, total > 0 ? barWidth * loaded / total : barWidth, barHeight};
+    
+    SDL_SetRenderDrawColor(renderer, 255, 215, 0, 255);
+    countDrawCall();
+    SDL_RenderFillRect(renderer, &fillRect);
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+    countDrawCall();
+    SDL_RenderDrawRect(renderer, &frameRect);
+    
+    SDL_RenderPresent(renderer);
+}
+
+std::vector<TextureRequest> Game::getTextureRequests() const {
+    return {
+        {PLAYER_TEXTURE_PATH, PLAYER_TEXTURE_ID, PLAYER_WIDTH, PLAYER_HEIGHT},
+        {OBSTACLE_TEXTURE_PATH, OBSTACLE_TEXTURE_ID, GRID_SIZE, GRID_SIZE},
+        {COIN_TEXTURE_PATH, COIN_TEXTURE_ID, GRID_SIZE, GRID_SIZE},
+        {FINISH_PATH, FINISH_TEXTURE_ID, 0, 0},
+        {BACKGROUND_PATH, BACKGROUND_TEXTURE_ID, 0, 0},
+        {MENU_BACKGROUND_PATH, MENU_BACKGROUND_ID, 0, 0},
+        {ABOUT_BACKGROUND_PATH, ABOUT_BACKGROUND_ID, 0, 0}
+    };
+}
+
+std::vector<std::string> Game::getScreenTextures(MenuState state) const {
+    switch (state) {
+        case MenuState::MAIN_MENU:
+        case MenuState::OPTIONS_MENU:
+            return {MENU_BACKGROUND_ID};
+        case MenuState::ABOUT:
+            return {ABOUT_BACKGROUND_ID};
+        case MenuState::GAME_PLAYING:
+        case MenuState::LEVEL_COMPLETE:
+            return {BACKGROUND_TEXTURE_ID, FINISH_TEXTURE_ID, OBSTACLE_TEXTURE_ID, COIN_TEXTURE_ID, PLAYER_TEXTURE_ID};
+        case MenuState::PAUSE_MENU:
+        case MenuState::GAME_OVER:
+            // Menu drawn over the frozen game
+            return {BACKGROUND_TEXTURE_ID, FINISH_TEXTURE_ID, OBSTACLE_TEXTURE_ID, COIN_TEXTURE_ID, PLAYER_TEXTURE_ID,
+                    MENU_BACKGROUND_ID};
+    }
+    return {};
+}
+
+bool Game::buildAssetPack(const std::string& packPath) const {
+    if (!TheTextureManager::Instance()->init()) {
+        std::cerr << "TextureManager initialization failed!" << std::endl;
+        return false;
+    }
+
+    std::vector<PackSource> sources;
+    for (const TextureRequest& request : getTextureRequests()) {
+        sources.push_back({request.fileName, PackEntryType::IMAGE, request.frameWidth, request.frameHeight});
+    }
+    sources.push_back({FONT_PATH, PackEntryType::FILE, 0, 0});
+
+    if (!writeAssetPack(packPath, sources)) {
+        std::cerr << "Failed to build asset pack!" << std::endl;
+        return false;
+    }
+    std::cout << "Wrote asset pack " << packPath << std::endl;
+    return true;
+}
+
+void Game::setJobWorkers(int workers) {
+    jobWorkers = workers;
+}
+
+void Game::setAudioDriver(const std::string& driver) {
+    audioDriver = driver;
+}
+
+void Game::setLatencyCsv(const std::string& path) {
+    latencyCsvPath = path;
+}
+
+const InputLatencyTracker& Game::getInputLatency() const {
+    return inputLatency;
+}
+
+void Game::setReleaseIdleMenus(bool release) {
+    releaseIdleMenus = release;
+}
+
+Menu* Game::getMenu(MenuState state) {
+    switch (state) {
+        case MenuState::MAIN_MENU:
+            if (!mainMenu) {
+                mainMenu = std::make_unique<MainMenu>(this);
+                mainMenu->setBackground(MENU_BACKGROUND_ID);
+            }
+            return mainMenu.get();
+        case MenuState::PAUSE_MENU:
+            if (!pauseMenu) {
+                pauseMenu = std::make_unique<PauseMenu>(this);
+                pauseMenu->setBackground(MENU_BACKGROUND_ID);
+            }
+            return pauseMenu.get();
+        case MenuState::GAME_OVER:
+            if (!gameOverMenu) {
+                gameOverMenu = std::make_unique<GameOverMenu>(this);
+                gameOverMenu->setBackground(MENU_BACKGROUND_ID);
+            }
+            return gameOverMenu.get();
+        case MenuState::OPTIONS_MENU:
+            if (!optionsMenu) {
+                optionsMenu = std::make_unique<OptionsMenu>(this);
+                optionsMenu->setBackground(MENU_BACKGROUND_ID);
+            }
+            return optionsMenu.get();
+        case MenuState::ABOUT:
+            if (!aboutMenu) {
+                aboutMenu = std::make_unique<AboutMenu>(this);
+                aboutMenu->setBackground(ABOUT_BACKGROUND_ID);
+            }
+            return aboutMenu.get();
+        case MenuState::GAME_PLAYING:
+        case MenuState::LEVEL_COMPLETE:
+            break;
+    }
+    return nullptr;
+}
+
+void Game::releaseMenus() {
+    // Called between frames, never from inside a menu's own event handler
+    if (!releaseIdleMenus) {
+        return;
+    }
+    if (menuState != MenuState::MAIN_MENU) mainMenu.reset();
+    if (menuState != MenuState::PAUSE_MENU) pauseMenu.reset();
+    if (menuState != MenuState::GAME_OVER) gameOverMenu.reset();
+    if (menuState != MenuState::ABOUT) aboutMenu.reset();
+    // optionsMenu holds the player's settings, so it is kept once built
 }
 
 void Game::handleEvents() {
@@ -99,35 +500,40 @@ void Game::handleEvents() {
             return;
         }
 
-        switch (menuState) {
-            case MenuState::MAIN_MENU:
-                if (mainMenu->handleEvent(event)) {
-                    continue;
-                }
-                break;
-            case MenuState::PAUSE_MENU:
-                if (pauseMenu->handleEvent(event)) {
-                    continue;
-                }
-                break;
-            case MenuState::GAME_OVER:
-                if (gameOverMenu->handleEvent(event)) {
-                    continue;
-                }
-                break;
-            case MenuState::OPTIONS_MENU:
-                if (optionsMenu->handleEvent(event)) {
-                    continue;
-                }
-                break;
-            case MenuState::ABOUT:
-                if (aboutMenu->handleEvent(event)) {
-                    continue;
-                }
-                break;
-            case MenuState::LEVEL_COMPLETE:
-            case MenuState::GAME_PLAYING:
-                break;
+        if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F3) {
+            showStats = !showStats;
+            continue;
+        }
+        
+        // Replay seeking: Page Up/Down jump 10 seconds, Home goes back to the start
+        if (replaying && event.type == SDL_KEYDOWN) {
+            uint32_t seekTicks = 10 * REPLAY_TICKS_PER_SECOND;
+            uint32_t now = replay.getTick();
+            if (event.key.keysym.sym == SDLK_PAGEUP) {
+                seekReplay(now > seekTicks ? now - seekTicks : 0);
+                continue;
+            }
+            if (event.key.keysym.sym == SDLK_PAGEDOWN) {
+                seekReplay(now + seekTicks);
+                continue;
+            }
+            if (event.key.keysym.sym == SDLK_HOME) {
+                seekReplay(0);
+                continue;
+            }
+        }
+        
+        if (event.type == SDL_KEYDOWN && !event.key.repeat) {
+            SDL_Scancode key = event.key.keysym.scancode;
+            if (key == SDL_SCANCODE_LEFT || key == SDL_SCANCODE_A ||
+                key == SDL_SCANCODE_RIGHT || key == SDL_SCANCODE_D) {
+                inputLatency.onInput(event.key.timestamp);
+            }
+        }
+
+        Menu* menu = getMenu(menuState);
+        if (menu && menu->handleEvent(event)) {
+            continue;
         }
 
         if (menuState == MenuState::GAME_PLAYING && gameState == GameState::PLAYING) {
@@ -139,125 +545,680 @@ void Game::handleEvents() {
         }
     }
 
+    // Steering is applied by the next tick, so it can be recorded
+    tickInput = 0;
+    rewindHeld = false;
+    const Uint8* currentKeyStates = SDL_GetKeyboardState(NULL);
+    if (!replaying && recordPath.empty() &&
+        ((menuState == MenuState::GAME_PLAYING && gameState == GameState::PLAYING) ||
+         menuState == MenuState::GAME_OVER)) {
+        rewindHeld = currentKeyStates[SDL_SCANCODE_BACKSPACE] != 0;
+    }
     if (menuState == MenuState::GAME_PLAYING && gameState == GameState::PLAYING) {
-        const Uint8* currentKeyStates = SDL_GetKeyboardState(NULL);
         if (currentKeyStates[SDL_SCANCODE_LEFT] || currentKeyStates[SDL_SCANCODE_A]) {
-            player->moveLeft();
+            tickInput |= INPUT_LEFT;
         }
         if (currentKeyStates[SDL_SCANCODE_RIGHT] || currentKeyStates[SDL_SCANCODE_D]) {
-            player->moveRight();
+            tickInput |= INPUT_RIGHT;
         }
     }
 }
 
 void Game::update() {
+    releaseMenus();
+    
     switch (menuState) {
         case MenuState::MAIN_MENU:
-            mainMenu->update();
-            break;
         case MenuState::PAUSE_MENU:
-            pauseMenu->update();
-            break;
-        case MenuState::GAME_OVER:
-            gameOverMenu->update();
-            break;
         case MenuState::OPTIONS_MENU:
-            optionsMenu->update();
-            break;
         case MenuState::ABOUT:
-            aboutMenu->update();
+            getMenu(menuState)->update();
+            break;
+        case MenuState::GAME_OVER:
+            if (rewindHeld && rewindStep()) {
+                break;
+            }
+            // Let the crash burst play out over the stopped map
+            particles->update(0.0f);
+            getMenu(menuState)->update();
             break;
         case MenuState::LEVEL_COMPLETE:
         case MenuState::GAME_PLAYING:
-            if (gameState == GameState::PLAYING) {
-                player->update();
-                gameMap->update();
-                
-                int points = 0;
-                bool collision = gameMap->checkCollision(player->getRect(), points);
-                
-                if (points > 0) {
-                    player->addScore(points);
-                    if (points >= MAX_SCORE) {
-                        gameState = GameState::FINISHED;
-                        menuState = MenuState::LEVEL_COMPLETE;
-                        gameOverMenu->setResults(player->getScore(), gameMap->getScrolledRows());
-                    }
+            if (rewindHeld) {
+                // One snapshot a frame rewinds at REWIND_INTERVAL times normal speed
+                rewindStep();
+            } else if (gameState == GameState::PLAYING) {
+                // Playback can run several ticks a frame, or none
+                int ticks = 1;
+                if (replaying) {
+                    replayTicksDue += replaySpeed;
+                    ticks = static_cast<int>(replayTicksDue);
+                    replayTicksDue -= ticks;
                 }
-                
-                if (collision) {
-                    player->kill();
-                    gameState = GameState::GAME_OVER;
-                    menuState = MenuState::GAME_OVER;
-                    gameOverMenu->setResults(player->getScore(), gameMap->getScrolledRows());
+                for (int i = 0; i < ticks && gameState == GameState::PLAYING; ++i) {
+                    runTick();
                 }
             }
             break;
     }
 }
 
+void Game::runTick() {
+    uint8_t input = tickInput;
+    if (autopilotEnabled && !replaying) {
+        input = getAutopilotInput();
+    }
+    if (replaying) {
+        if (replay.isFinished()) {
+            // The recording stopped without a crash or finish (the player quit)
+            finishRun();
+            setGameState(MenuState::GAME_OVER);
+            static_cast<GameOverMenu*>(getMenu(MenuState::GAME_OVER))
+                ->setResults(player->getScore(), gameMap->getScrolledRows());
+            return;
+        }
+        input = replay.nextInput();
+    } else if (!recordPath.empty()) {
+        if (replay.needsKeyframe()) {
+            StateWriter writer(replay.beginKeyframe());
+            saveState(writer);
+            replay.endKeyframe();
+        }
+        replay.recordTick(input);
+    } else if (!soaking && rewindTimer++ % REWIND_INTERVAL == 0) {
+        saveSnapshot(rewindSnapshots.push());
+    }
+    tick(input);
+}
+
+uint8_t Game::getAutopilotInput() {
+    Uint64 start = SDL_GetPerformanceCounter();
+    uint8_t input = autopilot.chooseInput(*gameMap, player->getRect(), entities.get());
+    soakStats.recordPlan((SDL_GetPerformanceCounter() - start) * 1000000.0 / SDL_GetPerformanceFrequency());
+    return input;
+}
+
+void Game::tick(uint8_t input) {
+    if (input & INPUT_LEFT) {
+        player->moveLeft();
+    }
+    if (input & INPUT_RIGHT) {
+        player->moveRight();
+    }
+    if (input && !replaying && !autopilotEnabled) {
+        inputLatency.onApplied();
+    }
+    
+    player->update();
+    gameMap->update();
+    if (++spawnTimer >= DYNAMIC_SPAWN_INTERVAL) {
+        spawnTimer = 0;
+        spawnDynamicEntity();
+    }
+    const SDL_Rect& playerRect = player->getRect();
+    entities->setHomingTarget(playerRect.x + playerRect.w * 0.5f, playerRect.y + playerRect.h * 0.5f);
+    entities->update();
+    broadphase->update(*entities, gameMap->getScrollPosition());
+    
+    // Same as GameMap::checkCollision, but keeping the result to place coin effects
+    CollisionResult result;
+    const CollisionMask* playerMask = player->getCollisionMask();
+    gameMap->queryCollisions(&playerRect, 1, &result, &playerMask);
+    for (int i = 0; i < result.rowCount && !fastForwarding; ++i) {
+        for (int col = 0; result.coinMasks[i] >> col; ++col) {
+            if (result.coinMasks[i] & (1u << col)) {
+                SDL_Rect cell = gameMap->getCellRect(result.firstRow + i, col);
+                particles->emit(coinEmitter, cell.x + cell.w * 0.5f, cell.y + cell.h * 0.5f,
+                                COIN_PARTICLE_BURST, 3.0f, 40);
+            }
+        }
+    }
+    int points = gameMap->applyPickups(result);
+    bool collision = collideEntities(points) || result.hitObstacle;
+    if (!fastForwarding) {
+        particles->update();
+    }
+    
+    if (points > 0) {
+        player->addScore(points);
+        if (points >= MAX_SCORE) {
+            if (!fastForwarding) {
+                TheAudioMixer::Instance()->playSound(SoundID::FINISH);
+            }
+            setGameState(MenuState::LEVEL_COMPLETE);
+            finishRun();
+        } else if (!fastForwarding) {
+            TheAudioMixer::Instance()->playSound(SoundID::COIN);
+        }
+    }
+    
+    // Reaching the finish ends the run, even if something is touched in the same tick
+    if (collision && gameState == GameState::PLAYING) {
+        player->kill();
+        if (!fastForwarding) {
+            TheAudioMixer::Instance()->playSound(SoundID::CRASH);
+            particles->emit(crashEmitter, playerRect.x + playerRect.w * 0.5f, playerRect.y + playerRect.h * 0.5f,
+                            CRASH_PARTICLE_BURST, 6.0f, 90);
+        }
+        setGameState(MenuState::GAME_OVER);
+        static_cast<GameOverMenu*>(getMenu(MenuState::GAME_OVER))
+            ->setResults(player->getScore(), gameMap->getScrolledRows());
+        finishRun();
+    }
+}
+
+void Game::startRun(uint32_t seed) {
+    runSeed = seed;
+    spawnCount = 0;
+    spawnTimer = 0;
+    player->reset(SCREEN_WIDTH / 2 - PLAYER_WIDTH / 2, SCREEN_HEIGHT - PLAYER_HEIGHT - 50);
+    
+    // Use the map prepared while the menu was up if it's for this seed
+    waitForNextMap();
+    if (nextMapReady && nextMapSeed == seed) {
+        std::swap(gameMap, nextMap);
+    } else {
+        gameMap->reset(seed);
+    }
+    nextMapReady = false;
+    
+    entities->clear();
+    broadphase->clear();
+    particles->clear();
+    
+    rewindSnapshots.clear();
+    rewindTimer = 0;
+    
+    runSaved = false;
+    if (!replaying && !recordPath.empty()) {
+        replay.begin(seed);
+    }
+}
+
+void Game::prepareNextMap() {
+    // Replays, soak games and the perf gate restart on their own seeds
+    if (replaying || scriptedSeeds || nextMapPending || nextMapReady) {
+        return;
+    }
+    nextMapSeed = std::random_device()();
+    nextMapJob = TheJobSystem::Instance()->submit(&Game::prepareNextMapJob, this);
+    nextMapPending = true;
+}
+
+void Game::prepareNextMapJob(void* data, int, int) {
+    Game* game = static_cast<Game*>(data);
+    game->nextMap->reset(game->nextMapSeed);
+}
+
+void Game::waitForNextMap() {
+    if (nextMapPending) {
+        TheJobSystem::Instance()->wait(nextMapJob);
+        nextMapPending = false;
+        nextMapReady = true;
+    }
+}
+
+void Game::finishRun() {
+    if (replaying) {
+        bool matched = player->getScore() == replay.getFinalScore() &&
+                       gameMap->getScrolledRows() == replay.getFinalDistance();
+        std::cout << "Replay ended at tick " << replay.getTick() << ": score " << player->getScore()
+                  << " (recorded " << replay.getFinalScore() << "), distance " << gameMap->getScrolledRows()
+                  << " (recorded " << replay.getFinalDistance() << ")" << std::endl;
+        if (!matched) {
+            std::cerr << "Replay diverged from the recording" << std::endl;
+            replayDiverged = true;
+        }
+        return;
+    }
+    if (recordPath.empty() || runSaved) {
+        return;
+    }
+    replay.finish(player->getScore(), gameMap->getScrolledRows());
+    if (replay.save(recordPath)) {
+        std::cout << "Recorded " << replay.getTickCount() << " ticks to " << recordPath << " ("
+                  << replay.getFileSize() << " bytes)" << std::endl;
+    }
+    runSaved = true;
+}
+
+void Game::saveState(StateWriter& writer) const {
+    writer.write(runSeed);
+    writer.write(spawnCount);
+    writer.write(static_cast<int32_t>(spawnTimer));
+    player->saveState(writer);
+    gameMap->saveState(writer);
+    entities->saveState(writer);
+}
+
+bool Game::loadState(StateReader& reader) {
+    int32_t savedSpawnTimer;
+    if (!reader.read(runSeed) || !reader.read(spawnCount) || !reader.read(savedSpawnTimer)) {
+        return false;
+    }
+    spawnTimer = savedSpawnTimer;
+    // The broadphase and particles are rebuilt from the restored entities and play
+    broadphase->clear();
+    particles->clear();
+    return player->loadState(reader) && gameMap->loadState(reader) && entities->loadState(reader) && reader.ok();
+}
+
+void Game::saveSnapshot(std::vector<uint8_t>& out) {
+    Uint64 start = SDL_GetPerformanceCounter();
+    out.clear();
+    StateWriter writer(out);
+    saveState(writer);
+    snapshotStats.recordSave((SDL_GetPerformanceCounter() - start) * 1000000.0 / SDL_GetPerformanceFrequency(),
+                             out.size());
+}
+
+bool Game::loadSnapshot(const uint8_t* data, size_t size) {
+    Uint64 start = SDL_GetPerformanceCounter();
+    StateReader reader(data, size);
+    if (!loadState(reader)) {
+        // A partly loaded map can't be played; start over from the snapshot's seed
+        std::cerr << "Snapshot is damaged" << std::endl;
+        startRun(runSeed);
+        return false;
+    }
+    snapshotStats.recordRestore((SDL_GetPerformanceCounter() - start) * 1000000.0 / SDL_GetPerformanceFrequency());
+    setGameState(MenuState::GAME_PLAYING);
+    return true;
+}
+
+const SnapshotStats& Game::getSnapshotStats() const {
+    return snapshotStats;
+}
+
+bool Game::rewindStep() {
+    const std::vector<uint8_t>* snapshot = rewindSnapshots.newest();
+    if (!snapshot) {
+        return false;
+    }
+    bool restored = loadSnapshot(snapshot->data(), snapshot->size());
+    rewindSnapshots.pop();
+    // The next tick snapshots the restored state again
+    rewindTimer = 0;
+    return restored;
+}
+
+void Game::seekReplay(uint32_t tick) {
+    if (!replaying) {
+        return;
+    }
+    if (tick > replay.getTickCount()) {
+        tick = replay.getTickCount();
+    }
+    Uint64 start = SDL_GetPerformanceCounter();
+    
+    // Restore the nearest keyframe at or before tick, then simulate the rest
+    const ReplayKeyframe* keyframe = replay.findKeyframe(tick);
+    if (keyframe) {
+        StateReader reader(replay.seekKeyframe(*keyframe), keyframe->stateSize);
+        if (!loadState(reader)) {
+            std::cerr << "Replay keyframe at tick " << keyframe->tick << " is damaged" << std::endl;
+            keyframe = nullptr;
+        }
+    }
+    if (!keyframe) {
+        replay.rewind();
+        startRun(replay.getSeed());
+    }
+    setGameState(MenuState::GAME_PLAYING);
+    
+    fastForwarding = true;
+    while (replay.getTick() < tick && gameState == GameState::PLAYING) {
+        runTick();
+    }
+    fastForwarding = false;
+    
+    std::cout << "Seek to " << replay.getTick() / static_cast<float>(REPLAY_TICKS_PER_SECOND) << " s took "
+              << (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency() << " ms" << std::endl;
+}
+
+bool Game::startReplay(const std::string& path, float speed, float startSeconds) {
+    if (!replay.load(path)) {
+        return false;
+    }
+    replaying = true;
+    replaySpeed = speed > 0.0f ? speed : 1.0f;
+    replayTicksDue = 0.0f;
+    std::cout << "Replay " << path << ": " << replay.getTickCount() / static_cast<float>(REPLAY_TICKS_PER_SECOND)
+              << " s, " << replay.getFileSize() << " bytes" << std::endl;
+    
+    startRun(replay.getSeed());
+    setGameState(MenuState::GAME_PLAYING);
+    if (startSeconds > 0.0f) {
+        seekReplay(static_cast<uint32_t>(startSeconds * REPLAY_TICKS_PER_SECOND));
+    }
+    return true;
+}
+
+void Game::runHeadless() {
+    Uint64 start = SDL_GetPerformanceCounter();
+    uint32_t firstTick = replay.getTick();
+    // Nothing is drawn unless capturing, so skip effects as when seeking
+    bool capturing = capture.isActive();
+    fastForwarding = !capturing;
+    while (running && replaying && gameState == GameState::PLAYING) {
+        stepFrame(false, capturing);
+    }
+    fastForwarding = false;
+    double seconds = (SDL_GetPerformanceCounter() - start) / static_cast<double>(SDL_GetPerformanceFrequency());
+    uint32_t ticks = replay.getTick() - firstTick;
+    std::cout << "Played " << ticks << " ticks in " << seconds * 1000.0 << " ms ("
+              << (seconds > 0.0 ? ticks / seconds : 0.0) << " ticks/s)" << std::endl;
+}
+
+bool Game::runPerfGate(int frames, const std::string& baselinePath, bool updateBaseline) {
+    // The same seeds and inputs every time; a crash or finish starts the next seed.
+    // No map is prepared in the background, so no job competes with the measured frames.
+    scriptedSeeds = true;
+    uint32_t seed = PERF_SEED;
+    int runs = 1;
+    startRun(seed);
+    setGameState(MenuState::GAME_PLAYING);
+    
+    PerfRecorder recorder(frames);
+    Uint64 start = SDL_GetPerformanceCounter();
+    bool runStarted = true;     // The first frame of a run frees the last one's game-over menu
+    for (uint32_t frame = 0; running && recorder.getFrameCount() < frames; ++frame) {
+        Uint64 frameStart = SDL_GetPerformanceCounter();
+        uint64_t drawCallStart = getDrawCallCount();
+        
+        tickInput = getPerfInput(frame);
+        stepFrame(false, true);
+        
+        double ms = (SDL_GetPerformanceCounter() - frameStart) * 1000.0 / SDL_GetPerformanceFrequency();
+        // Frames that end or start a run change screens, and aren't gameplay
+        bool runBoundary = runStarted || gameState != GameState::PLAYING;
+        runStarted = false;
+        if (frame >= static_cast<uint32_t>(PERF_WARMUP_FRAMES) && !runBoundary) {
+            const FrameAllocations& allocations = lastFrameAllocations;
+            recorder.recordFrame(frame, ms, allocations.events.count + allocations.update.count + allocations.render.count,
+                                 getDrawCallCount() - drawCallStart);
+        }
+        if (gameState != GameState::PLAYING) {
+            startRun(++seed);
+            setGameState(MenuState::GAME_PLAYING);
+            ++runs;
+            runStarted = true;
+        }
+    }
+    tickInput = 0;
+    scriptedSeeds = false;
+    
+    double seconds = (SDL_GetPerformanceCounter() - start) / static_cast<double>(SDL_GetPerformanceFrequency());
+    PerfMetrics metrics = recorder.getMetrics();
+    std::cout << "Perf gate: " << runs << " runs in " << seconds << " s" << std::endl;
+    printPerfMetrics(metrics);
+    if (!isAllocationTrackingEnabled()) {
+        std::cout << "Allocations are only counted in TRACK_ALLOCATIONS builds" << std::endl;
+    }
+    
+    // Gameplay frames must not allocate, whatever the baseline says
+    if (metrics.allocatingFrames > 0) {
+        std::cerr << "Perf gate FAILED: " << metrics.allocatingFrames << " measured frames allocated, the first at frame "
+                  << metrics.firstAllocatingFrame << std::endl;
+        return false;
+    }
+    
+    PerfMetrics baseline;
+    if (updateBaseline || !loadPerfBaseline(baselinePath, baseline)) {
+        if (!updateBaseline) {
+            std::cout << "No baseline at " << baselinePath << ", writing one" << std::endl;
+        }
+        return savePerfBaseline(baselinePath, metrics);
+    }
+    if (baseline.frames != metrics.frames) {
+        std::cout << "Baseline measured " << baseline.frames << " frames, this run " << metrics.frames << std::endl;
+    }
+    if (!comparePerfMetrics(baseline, metrics)) {
+        std::cerr << "Perf gate FAILED: see REGRESSED rows above (baseline " << baselinePath << ")" << std::endl;
+        return false;
+    }
+    std::cout << "Perf gate passed" << std::endl;
+    return true;
+}
+
+void Game::setAutopilot(bool enabled) {
+    autopilotEnabled = enabled;
+}
+
+void Game::runSoak(int games) {
+    // Nothing is drawn, so skip effects as when seeking
+    autopilotEnabled = true;
+    soaking = true;
+    scriptedSeeds = true;
+    fastForwarding = true;
+    soakStats = SurvivalStats();
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int game = 0; running && game < games; ++game) {
+        startRun(AUTOPILOT_SOAK_SEED + game);
+        setGameState(MenuState::GAME_PLAYING);
+        int ticks = 0;
+        while (running && gameState == GameState::PLAYING && ticks < AUTOPILOT_SOAK_MAX_TICKS) {
+            stepFrame(false, false);
+            ++ticks;
+        }
+        soakStats.recordGame(gameMap->getScrolledRows(), ticks, gameState == GameState::FINISHED,
+                             gameState == GameState::PLAYING);
+    }
+    fastForwarding = false;
+    soaking = false;
+    scriptedSeeds = false;
+    double seconds = (SDL_GetPerformanceCounter() - start) / static_cast<double>(SDL_GetPerformanceFrequency());
+    soakStats.print(seconds);
+}
+
+bool Game::didReplayDiverge() const {
+    return replayDiverged;
+}
+
+void Game::setRenderScale(float scale) {
+    resolution.setFixedScale(scale);
+}
+
+void Game::setCpuRenderer(bool enabled) {
+    cpuRenderer = enabled;
+}
+
+bool Game::benchmarkRenderer(int frames) const {
+    if (!TheJobSystem::Instance()->init(jobWorkers)) {
+        std::cerr << "JobSystem initialization failed!" << std::endl;
+        return false;
+    }
+    bool success = benchmarkRasterizer(frames);
+    success = benchmarkParticles(frames) && success;
+    TheJobSystem::Instance()->clean();
+    return success;
+}
+
+void Game::setRecordPath(const std::string& path) {
+    recordPath = path;
+}
+
+void Game::setCapturePath(const std::string& path) {
+    capturePath = path;
+}
+
+void Game::setHeadless(bool enabled) {
+    headless = enabled;
+}
+
+void Game::spawnDynamicEntity() {
+    Entity entity = entities->create();
+    if (entity.index == NO_ENTITY.index) {
+        return;
+    }
+    
+    // Seeded per spawn from the run, so replays and restored keyframes spawn the same things
+    spawnRng.seed(runSeed ^ (++spawnCount * 0x85EBCA6Bu));
+    
+    // Enter just above the screen in a random column
+    float x = static_cast<float>(std::uniform_int_distribution<int>(0, GRID_COLS - 1)(spawnRng) * GRID_SIZE);
+    entities->getPositions().add(entity, Position{x, -static_cast<float>(GRID_SIZE)});
+    
+    Sprite obstacleSprite = {obstacleSlot, GRID_SIZE, GRID_SIZE, 0, OBSTACLE_FRAMES, OBSTACLE_ANIMATION_SPEED, 0};
+    Sprite coinSprite = {coinSlot, GRID_SIZE, GRID_SIZE, 0, COIN_FRAMES, COIN_ANIMATION_SPEED, 0};
+    Collider box = {GRID_SIZE / 6, GRID_SIZE / 6, GRID_SIZE * 2 / 3, GRID_SIZE * 2 / 3};
+    
+    switch (std::uniform_int_distribution<int>(0, 2)(spawnRng)) {
+        case 0: {
+            // Sliding obstacle, bounces between the screen sides
+            float direction = std::uniform_int_distribution<int>(0, 1)(spawnRng) ? 1.0f : -1.0f;
+            entities->getVelocities().add(entity, Velocity{SLIDING_OBSTACLE_SPEED * direction, 0.0f});
+            entities->getSprites().add(entity, obstacleSprite);
+            entities->getColliders().add(entity, box);
+            entities->getHazards().add(entity, Hazard{});
+            break;
+        }
+        case 1:
+            // Projectile, falls faster than the map scrolls
+            entities->getVelocities().add(entity, Velocity{0.0f, PROJECTILE_SPEED});
+            entities->getSprites().add(entity, obstacleSprite);
+            entities->getColliders().add(entity, box);
+            entities->getHazards().add(entity, Hazard{});
+            break;
+        default:
+            // Homing coin, drifts towards the player
+            entities->getVelocities().add(entity, Velocity{0.0f, 0.0f});
+            entities->getHomings().add(entity, Homing{HOMING_COIN_SPEED});
+            entities->getSprites().add(entity, coinSprite);
+            entities->getColliders().add(entity, box);
+            entities->getPickups().add(entity, Pickup{10});
+            break;
+    }
+}
+
+bool Game::collideEntities(int& points) {
+    // Hazards crush any pickup they run into
+    FrameArena* arena = TheFrameArena::Instance();
+    size_t arenaMarker = arena->mark();
+    const int maxPairs = 1024;
+    EntityPair* pairs = arena->allocateArray<EntityPair>(maxPairs);
+    int pairCount = pairs ? broadphase->queryPairs(pairs, maxPairs) : 0;
+    for (int i = 0; i < pairCount; ++i) {
+        uint32_t first = pairs[i].first;
+        uint32_t second = pairs[i].second;
+        if (entities->getHazards().has(first) && entities->getPickups().has(second)) {
+            entities->destroy(entities->getEntity(second));
+        } else if (entities->getHazards().has(second) && entities->getPickups().has(first)) {
+            entities->destroy(entities->getEntity(first));
+        }
+    }
+    arena->rewind(arenaMarker);
+    
+    // Then the player against everything nearby
+    uint32_t hits[64];
+    int hitCount = broadphase->query(player->getRect(), hits, 64);
+    bool hitHazard = false;
+    for (int i = 0; i < hitCount; ++i) {
+        Entity entity = entities->getEntity(hits[i]);
+        if (!entities->isAlive(entity)) {
+            continue; // Crushed above
+        }
+        if (entities->getHazards().has(hits[i])) {
+            hitHazard = true;
+        } else if (const Pickup* pickup = entities->getPickups().get(hits[i])) {
+            points += pickup->value;
+            const Position* position = entities->getPositions().get(hits[i]);
+            if (position && !fastForwarding) {
+                particles->emit(coinEmitter, position->x + GRID_SIZE * 0.5f, position->y + GRID_SIZE * 0.5f,
+                                COIN_PARTICLE_BURST, 3.0f, 40);
+            }
+            entities->destroy(entity);
+        }
+    }
+    return hitHazard;
+}
+
 void Game::render() {
     SDL_SetRenderDrawColor(renderer, 50, 50, 50, 255);
     SDL_RenderClear(renderer);
 
     switch (menuState) {
         case MenuState::MAIN_MENU:
-            mainMenu->render(renderer);
+            getMenu(menuState)->render(renderer);
             break;
         case MenuState::PAUSE_MENU:
-            TheTextureManager::Instance()->draw(BACKGROUND_TEXTURE_ID, 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, renderer);
-            gameMap->render(renderer);
-            player->render(renderer);
+            renderWorld();
             renderUI();
-            pauseMenu->render(renderer);
+            getMenu(menuState)->render(renderer);
             break;
         case MenuState::GAME_OVER:
-            TheTextureManager::Instance()->draw(BACKGROUND_TEXTURE_ID, 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, renderer);
-            gameMap->render(renderer);
-            player->render(renderer);
+            renderWorld();
             renderUI();
-            gameOverMenu->render(renderer);
+            getMenu(menuState)->render(renderer);
             break;
         case MenuState::OPTIONS_MENU:
-            optionsMenu->render(renderer);
+            getMenu(menuState)->render(renderer);
             break;
         case MenuState::ABOUT:
-            aboutMenu->render(renderer);
+            getMenu(menuState)->render(renderer);
             break;
         case MenuState::LEVEL_COMPLETE:
         case MenuState::GAME_PLAYING:
-            TheTextureManager::Instance()->draw(BACKGROUND_TEXTURE_ID, 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, renderer);
-            gameMap->render(renderer);
-            player->render(renderer);
+            renderWorld();
             renderUI();
             
             if (menuState == MenuState::LEVEL_COMPLETE) {
-                SDL_Color messageColor = {0, 255, 0, 255};
-                const char* message = "Level Complete! Press R to restart";
-                
-                TTF_Font* bigFont = TTF_OpenFont("assets/arial.ttf", 36);
-                if (bigFont) {
-                    SDL_Surface* msgSurface = TTF_RenderText_Blended(bigFont, message, messageColor);
-                    if (msgSurface) {
-                        SDL_Texture* msgTexture = SDL_CreateTextureFromSurface(renderer, msgSurface);
-                        SDL_Rect msgRect = {
-                            (SCREEN_WIDTH - msgSurface->w) / 2,
-                            (SCREEN_HEIGHT - msgSurface->h) / 2,
-                            msgSurface->w,
-                            msgSurface->h
-                        };
-                        SDL_RenderCopy(renderer, msgTexture, nullptr, &msgRect);
-                        
-                        SDL_FreeSurface(msgSurface);
-                        SDL_DestroyTexture(msgTexture);
-                    }
-                    TTF_CloseFont(bigFont);
-                }
+                drawTextSprite(levelCompleteText,
+                               (SCREEN_WIDTH - levelCompleteText.width) / 2,
+                               (SCREEN_HEIGHT - levelCompleteText.height) / 2);
             }
             break;
     }
+    
+    if (showStats) {
+        renderStatsOverlay();
+    }
 
+    capture.captureFrame(renderer);
     SDL_RenderPresent(renderer);
+    inputLatency.onPresented();
+}
+
+void Game::renderWorld() {
+    // Drawn in game coordinates either way; the render scale shrinks them into the target
+    float scale = resolution.getScale();
+    if (rasterizer) {
+        // Same grey as the window is cleared to. Particles are geometry, which the
+        // rasterizer doesn't do, so they and the player go on top through SDL.
+        rasterizer->begin(resolution.getWidth(), resolution.getHeight(), scale, 0xFF323232);
+        TheTextureManager::Instance()->setRasterizer(rasterizer.get());
+        TheTextureManager::Instance()->draw(BACKGROUND_TEXTURE_ID, 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, renderer);
+        gameMap->render(renderer);
+        entities->render(renderer);
+        TheTextureManager::Instance()->setRasterizer(nullptr);
+        
+        SDL_Rect screen = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+        rasterizer->present(renderer, screen);
+        particles->render(renderer);
+        player->render(renderer);
+        return;
+    }
+    
+    bool scaled = sceneTarget && scale < RENDER_SCALE_MAX;
+    if (scaled) {
+        SDL_SetRenderTarget(renderer, sceneTarget);
+        SDL_RenderSetScale(renderer, scale, scale);
+    }
+    
+    TheTextureManager::Instance()->draw(BACKGROUND_TEXTURE_ID, 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, renderer);
+    gameMap->render(renderer);
+    entities->render(renderer);
+    particles->render(renderer);
+    player->render(renderer);
+    
+    if (scaled) {
+        // Back to the window, whose scale SDL restores, and stretch the world over it
+        SDL_SetRenderTarget(renderer, nullptr);
+        SDL_Rect source = {0, 0, resolution.getWidth(), resolution.getHeight()};
+        SDL_Rect screen = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+        countDrawCall();
+        SDL_RenderCopy(renderer, sceneTarget, &source, &screen);
+    }
 }
 
 void Game::renderUI() {
@@ -266,39 +1227,80 @@ void Game::renderUI() {
     if (menuState == MenuState::GAME_PLAYING || menuState == MenuState::PAUSE_MENU || menuState == MenuState::GAME_OVER) {
         SDL_SetRenderDrawColor(renderer, 0, 0, 0, 150);
         SDL_Rect scoreBg = {10, 10, 150, 40};
+        countDrawCall();
         SDL_RenderFillRect(renderer, &scoreBg);
         
         SDL_Rect distanceBg = {SCREEN_WIDTH - 160, 10, 150, 40};
+        countDrawCall();
         SDL_RenderFillRect(renderer, &distanceBg);
 
-        SDL_Color textColor = {255, 255, 255, 255};
-        std::string scoreText = "Score: " + std::to_string(player->getScore());
-        SDL_Surface* textSurface = TTF_RenderText_Solid(font, scoreText.c_str(), textColor);
-        if (textSurface) {
-            SDL_Texture* textTexture = SDL_CreateTextureFromSurface(renderer, textSurface);
-            SDL_Rect textRect = {20, 15, textSurface->w, textSurface->h};
-            SDL_RenderCopy(renderer, textTexture, nullptr, &textRect);
-            
-            SDL_FreeSurface(textSurface);
-            SDL_DestroyTexture(textTexture);
-        }
-        
-        std::string distanceText = "Distance: " + std::to_string(gameMap->getScrolledRows());
-        textSurface = TTF_RenderText_Solid(font, distanceText.c_str(), textColor);
-        if (textSurface) {
-            SDL_Texture* textTexture = SDL_CreateTextureFromSurface(renderer, textSurface);
-            SDL_Rect textRect = {SCREEN_WIDTH - 150, 15, textSurface->w, textSurface->h};
-            SDL_RenderCopy(renderer, textTexture, nullptr, &textRect);
-            
-            SDL_FreeSurface(textSurface);
-            SDL_DestroyTexture(textTexture);
-        }
+        drawNumber(player->getScore(), drawTextSprite(scoreLabel, 20, 15), 15);
+        drawNumber(gameMap->getScrolledRows(), drawTextSprite(distanceLabel, SCREEN_WIDTH - 150, 15), 15);
     }
 }
 
 void Game::clean() {
+    destroyHudText();
+    if (isAllocationTrackingEnabled() && checkedFrames > 0) {
+        std::cout << "Allocation check: " << allocatingFrames << " of " << checkedFrames
+                  << " gameplay frames allocated" << std::endl;
+    }
+    
+    // A run the player quit mid-way is still worth keeping
+    if (player && gameState == GameState::PLAYING) {
+        finishRun();
+    }
+    
+    const LatencyHistogram& inputToPresent = inputLatency.getHistogram(LatencyStage::INPUT_TO_PRESENT);
+    if (inputToPresent.getCount() > 0) {
+        std::cout << "Input to present latency: " << inputToPresent.getPercentile(0.5) << " ms median, "
+                  << inputToPresent.getPercentile(0.95) << " ms p95, " << inputToPresent.getMax() << " ms max over "
+                  << inputToPresent.getCount() << " presses" << std::endl;
+    }
+    if (!latencyCsvPath.empty()) {
+        inputLatency.writeCsv(latencyCsvPath);
+    }
+    
+    if (snapshotStats.getSaves() > 0) {
+        std::cout << "Snapshots: " << snapshotStats.getSaves() << " taken (" << snapshotStats.getAverageSave()
+                  << " us average, " << snapshotStats.getMaxSave() << " us max, up to "
+                  << snapshotStats.getMaxBytes() << " bytes), " << snapshotStats.getRestores() << " restored ("
+                  << snapshotStats.getAverageRestore() << " us average, " << snapshotStats.getMaxRestore()
+                  << " us max)" << std::endl;
+    }
+    
+    if (TheAudioMixer::Instance()->isOpen()) {
+        AudioLatencyStats audio = TheAudioMixer::Instance()->getLatencyStats();
+        if (audio.sounds > 0) {
+            std::cout << "Audio latency: " << audio.averageMs << " ms average, " << audio.maxMs << " ms max over "
+                      << audio.sounds << " sounds (" << audio.bufferMs << " ms buffer)" << std::endl;
+            if (audio.maxMs > AUDIO_LATENCY_TARGET_MS) {
+                std::cerr << "Audio latency exceeded " << AUDIO_LATENCY_TARGET_MS << " ms" << std::endl;
+            }
+        }
+    }
+    
+    waitForNextMap();
+    JobSystem* jobSystem = TheJobSystem::Instance();
+    for (int worker = 0; worker < jobSystem->getWorkerCount(); ++worker) {
+        WorkerStats stats = jobSystem->getWorkerStats(worker);
+        if (stats.jobsRun > 0) {
+            std::cout << "Job worker " << worker << ": " << stats.jobsRun << " jobs (" << stats.jobsStolen
+                      << " stolen), " << stats.busySeconds * 1000.0 << " ms busy, "
+                      << stats.utilization * 100.0 << "% utilization" << std::endl;
+        }
+    }
+    capture.stop();
+    TheAudioMixer::Instance()->clean();
     TheTextureManager::Instance()->clean();
+    TheJobSystem::Instance()->clean();
+    TheFrameArena::Instance()->clean();
     
+    rasterizer.reset();
+    if (sceneTarget) {
+        SDL_DestroyTexture(sceneTarget);
+        sceneTarget = nullptr;
+    }
     if (renderer) {
         SDL_DestroyRenderer(renderer);
         renderer = nullptr;
@@ -323,10 +1325,11 @@ void Game::run() {
 
     while (running) {
         frameStart = SDL_GetTicks();
+        Uint64 workStart = SDL_GetPerformanceCounter();
+        stepFrame(true, true);
         
-        handleEvents();
-        update();
-        render();
+        // Work up to and including the present, which waits for the GPU when it falls behind
+        resolution.recordFrame((SDL_GetPerformanceCounter() - workStart) * 1000.0 / SDL_GetPerformanceFrequency());
 
         frameTime = SDL_GetTicks() - frameStart;
         if (frameDelay > frameTime) {
@@ -335,7 +1338,84 @@ void Game::run() {
     }
 }
 
+void Game::stepFrame(bool readEvents, bool draw) {
+    TheFrameArena::Instance()->reset();
+    bool gameplayFrame = menuState == MenuState::GAME_PLAYING && gameState == GameState::PLAYING;
+    
+    AllocationCounts stageStart = getAllocationCounts();
+    if (readEvents) {
+        handleEvents();
+    }
+    lastFrameAllocations.events = allocationsSince(stageStart);
+    
+    stageStart = getAllocationCounts();
+    update();
+    lastFrameAllocations.update = allocationsSince(stageStart);
+    
+    stageStart = getAllocationCounts();
+    if (draw) {
+        render();
+    }
+    lastFrameAllocations.render = allocationsSince(stageStart);
+    
+    // A frame that changed screens is allowed to allocate
+    gameplayFrame = gameplayFrame && menuState == MenuState::GAME_PLAYING && gameState == GameState::PLAYING;
+    checkFrameAllocations(gameplayFrame);
+}
+
+void Game::checkFrameAllocations(bool gameplayFrame) {
+    if (!isAllocationTrackingEnabled()) {
+        return;
+    }
+    if (!gameplayFrame) {
+        gameplayFrames = 0;
+        return;
+    }
+    if (++gameplayFrames <= ALLOCATION_WARMUP_FRAMES) {
+        return;
+    }
+    
+    // Past warm-up a gameplay frame must not touch the heap
+    ++checkedFrames;
+    const FrameAllocations& frame = lastFrameAllocations;
+    uint64_t count = frame.events.count + frame.update.count + frame.render.count;
+    if (count == 0) {
+        return;
+    }
+    ++allocatingFrames;
+    std::cerr << "Gameplay frame allocated " << count << " times ("
+              << frame.events.bytes + frame.update.bytes + frame.render.bytes << " bytes): "
+              << "events " << frame.events.count << "/" << frame.events.bytes
+              << ", update " << frame.update.count << "/" << frame.update.bytes
+              << ", render " << frame.render.count << "/" << frame.render.bytes << std::endl;
+    if (strictAllocations) {
+        allocationCheckFailed = true;
+        running = false;
+    }
+}
+
+void Game::setStrictAllocations(bool strict) {
+    strictAllocations = strict;
+}
+
+bool Game::didAllocationCheckFail() const {
+    return allocationCheckFailed;
+}
+
+const FrameAllocations& Game::getLastFrameAllocations() const {
+    return lastFrameAllocations;
+}
+
 void Game::setGameState(MenuState state) {
+    // Pin the new screen's textures before unpinning the old ones so shared ones stay resident
+    if (state != menuState) {
+        for (const std::string& id : getScreenTextures(state)) {
+            TheTextureManager::Instance()->acquire(id, renderer);
+        }
+        for (const std::string& id : getScreenTextures(menuState)) {
+            TheTextureManager::Instance()->release(id);
+        }
+    }
     menuState = state;
     
     switch (menuState) {
@@ -344,9 +1424,11 @@ void Game::setGameState(MenuState state) {
             break;
         case MenuState::GAME_OVER:
             gameState = GameState::GAME_OVER;
+            prepareNextMap();
             break;
         case MenuState::LEVEL_COMPLETE:
             gameState = GameState::FINISHED;
+            prepareNextMap();
             break;
         case MenuState::MAIN_MENU:
         case MenuState::PAUSE_MENU:
@@ -362,9 +1444,13 @@ void Game::quit() {
 }
 
 void Game::restart() {
-    player = std::make_unique<Player>(SCREEN_WIDTH / 2 - PLAYER_WIDTH / 2, SCREEN_HEIGHT - PLAYER_HEIGHT - 50);
-    player->setTextureID(PLAYER_TEXTURE_ID);
-    gameMap = std::make_unique<GameMap>();
-    gameState = GameState::PLAYING;
-    menuState = MenuState::GAME_PLAYING;
+    // A replay restarts from its own beginning
+    if (replaying) {
+        replay.rewind();
+        startRun(replay.getSeed());
+    } else {
+        prepareNextMap();
+        startRun(nextMapSeed);
+    }
+    setGameState(MenuState::GAME_PLAYING);
 }
\ No newline at end of file
@@ -6,26 +6,154 @@
 #include <memory>
 #include "gameobject.h"
 #include "gamemap.h"
+#include "entities.h"
+#include "broadphase.h"
+#include "particles.h"
+#include <random>
 #include "texturemanager.h"
 #include "menu.h"
+#include "allocstats.h"
+#include "allocators.h"
+#include "latency.h"
+#include "replay.h"
+#include "snapshot.h"
+#include "jobsystem.h"
+#include "resolution.h"
+#include "capture.h"
+#include "perfgate.h"
+#include "autopilot.h"
+
+// Time one step of Game::init() took
+struct StartupPhase {
+    const char* name;
+    double ms;
+};
+
+// Text rendered once at startup so the HUD draws without allocating
+struct TextSprite {
+    SDL_Texture* texture;
+    int width;
+    int height;
+};
+
+// Labels used by the stats overlay
+enum StatsText {
+    STATS_CELLS,
+    STATS_ARENA,
+    STATS_TEXTURES,
+    STATS_ALLOCATIONS,
+    STATS_ENTITIES,
+    STATS_PARTICLES,
+    STATS_INPUT_TO_APPLY,
+    STATS_APPLY_TO_PRESENT,
+    STATS_INPUT_TO_PRESENT,
+    STATS_RESOLUTION,
+    STATS_BY,
+    STATS_FRAME_MS,
+    STATS_P95,
+    STATS_PEAK,
+    STATS_OF,
+    STATS_TEXT_COUNT
+};
+
+// Heap allocations made by each stage of one frame (allocation tracking builds only)
+struct FrameAllocations {
+    AllocationCounts events;
+    AllocationCounts update;
+    AllocationCounts render;
+};
 
 class Game {
 private:
     SDL_Window* window;
     SDL_Renderer* renderer;
+    SDL_Texture* sceneTarget = nullptr;     // The world is drawn here at the render scale, then stretched
+    ResolutionScaler resolution;
+    bool cpuRenderer = false;
+    std::unique_ptr<SoftwareRasterizer> rasterizer; // Draws the world when cpuRenderer is set
     std::unique_ptr<Player> player;
     std::unique_ptr<GameMap> gameMap;
+    std::unique_ptr<GameMap> nextMap;       // Next run's map, prepared on the job system after a run ends
+    uint32_t nextMapSeed = 0;
+    JobHandle nextMapJob = {};
+    bool nextMapPending = false;            // nextMapJob submitted and not yet waited for
+    bool nextMapReady = false;              // nextMap holds a fresh map for nextMapSeed
+    std::unique_ptr<EntityWorld> entities;  // Dynamic objects that move on their own
+    std::unique_ptr<Broadphase> broadphase;
+    std::mt19937 spawnRng;              // Reseeded for every spawn (see spawnDynamicEntity)
+    int spawnTimer = 0;
+    int obstacleSlot = 0;                   // EntityWorld texture slots
+    int coinSlot = 0;
+    std::unique_ptr<ParticleSystem> particles;
+    int coinEmitter = 0;
+    int crashEmitter = 0;
     GameState gameState;
     MenuState menuState;
     TTF_Font* font = nullptr;
     bool running;
+    int jobWorkers = 0;     // Job system workers; 0 = one per core, 1 = single-threaded
+    std::string audioDriver; // SDL audio driver to use; empty lets SDL choose
 
-    // Menus
+    // Menus, built on first entry to their state (see getMenu)
     std::unique_ptr<MainMenu> mainMenu;
     std::unique_ptr<PauseMenu> pauseMenu;
     std::unique_ptr<GameOverMenu> gameOverMenu;
     std::unique_ptr<OptionsMenu> optionsMenu;
     std::unique_ptr<AboutMenu> aboutMenu;  // Added for About screen
+    bool releaseIdleMenus = true;  // Free menus once their state is left
+    
+    // HUD text
+    TextSprite scoreLabel = {};
+    TextSprite distanceLabel = {};
+    TextSprite levelCompleteText = {};
+    TextSprite digitSprites[10] = {};
+    TextSprite statsText[STATS_TEXT_COUNT] = {};
+    bool showStats = false;         // Toggled with F3
+    
+    // Allocation tracking
+    FrameAllocations lastFrameAllocations = {};
+    int gameplayFrames = 0;         // Consecutive gameplay frames, for warm-up
+    uint64_t checkedFrames = 0;
+    uint64_t allocatingFrames = 0;
+    bool strictAllocations = false; // Stop at the first allocating gameplay frame
+    bool allocationCheckFailed = false;
+    
+    // Runs and replays
+    uint32_t runSeed = 0;           // Seeds the map and the entity spawns of the current run
+    uint32_t spawnCount = 0;        // Spawns so far this run
+    uint8_t tickInput = 0;          // INPUT_LEFT/INPUT_RIGHT read by handleEvents for the next tick
+    Replay replay;                  // Recording, or the replay being played back
+    std::string recordPath;         // Each run is recorded and saved here when set
+    std::string capturePath;        // Presented frames are captured to this video file when set
+    VideoCapture capture;
+    bool runSaved = false;          // The current run's recording has been written
+    bool replaying = false;
+    bool replayDiverged = false;    // Playback ended with a different score or distance
+    float replaySpeed = 1.0f;       // Ticks per frame during playback
+    float replayTicksDue = 0.0f;
+    bool fastForwarding = false;    // Seeking: simulate without effects or sound
+    bool headless = false;          // No visible window; replays run as fast as possible
+    
+    // Autopilot steering and soak tests
+    Autopilot autopilot;
+    bool autopilotEnabled = false;  // Steer with the autopilot instead of the keyboard
+    bool soaking = false;           // runSoak is playing; no rewind snapshots
+    bool scriptedSeeds = false;     // runSoak or runPerfGate picks each run's seed, so no next map is prepared
+    SurvivalStats soakStats;
+    
+    // Rewind (held Backspace), not available while recording or replaying
+    SnapshotRing rewindSnapshots{REWIND_SLOTS, SNAPSHOT_RESERVE};
+    int rewindTimer = 0;            // Ticks since the last rewind snapshot
+    bool rewindHeld = false;
+    SnapshotStats snapshotStats;
+    
+    // Steering input latency
+    InputLatencyTracker inputLatency;
+    std::string latencyCsvPath;     // Histograms are written here on exit if set
+    
+    // Startup profile
+    std::vector<StartupPhase> startupPhases;
+    Uint64 phaseStart = 0;
     
     // Texture IDs
     const std::string PLAYER_TEXTURE_ID = "player";
@@ -35,18 +163,84 @@ private:
     const std::string BACKGROUND_TEXTURE_ID = "background";
     const std::string MENU_BACKGROUND_ID = "menu_background";
     const std::string ABOUT_BACKGROUND_ID = "about_background";  // Added for About screen
+    const std::string PARTICLE_TEXTURE_ID = "particle";
 
     void handleEvents();
+    void startRun(uint32_t seed);   // Reset player, map and entities in place for a run from seed
+    void prepareNextMap();          // Start generating the next run's map in the background
+    void waitForNextMap();
+    static void prepareNextMapJob(void* data, int begin, int end);
+    void runTick();                 // Next tick of the run, with recorded or live input
+    uint8_t getAutopilotInput();    // Plan the next tick and time the planning
+    void tick(uint8_t input);       // One gameplay tick
+    void finishRun();               // Save the recording or check the replay's result
+    void saveState(StateWriter& writer) const;
+    bool loadState(StateReader& reader);
+    void seekReplay(uint32_t tick);
+    bool rewindStep();              // Restore the newest rewind snapshot; false if there is none
+    void spawnDynamicEntity();
+    bool collideEntities(int& points);      // True if the player hit a hazard
     void update();
     void render();
+    void renderWorld();             // Background, map, entities, particles and player, at the render scale
     void renderUI();
     void clean();
-    void initMenus(); // Initialize menus
+    Menu* getMenu(MenuState state); // Menu for a state, created on demand; nullptr if none
+    void releaseMenus();            // Drop menus that aren't showing
+    void markStartupPhase(const char* name);
+    bool createHudText();
+    void destroyHudText();
+    bool createTextSprite(TTF_Font* textFont, const char* text, SDL_Color color, TextSprite& sprite,
+                          bool blended = false);
+    int drawTextSprite(const TextSprite& sprite, int x, int y); // Returns the x after the text
+    int drawNumber(int value, int x, int y); // Returns the x after the number
+    int drawUsage(const AllocatorStats& stats, size_t unit, int x, int y);
+    void renderStatsOverlay();
+    void drawLatency(const LatencyHistogram& histogram, const TextSprite& label, int x, int y);
+    // One frame: events (when readEvents), update and render (when draw), each stage's
+    // allocations counted and gameplay frames checked. Every frame loop goes through here,
+    // so unattended runs catch allocating frames the same way interactive play does.
+    void stepFrame(bool readEvents, bool draw);
+    void checkFrameAllocations(bool gameplayFrame);
+    void renderLoadingScreen(int loaded, int total);
+    std::vector<TextureRequest> getTextureRequests() const;
+    std::vector<std::string> getScreenTextures(MenuState state) const; // Textures a screen draws
 
 public:
     Game();
     ~Game();
     bool init(const char* title, int xpos, int ypos, int width, int height, bool fullscreen);
+    void setJobWorkers(int workers); // Call before init()
+    void setAudioDriver(const std::string& driver); // Call before init(), e.g. "dummy" or "disk"
+    void setReleaseIdleMenus(bool release);
+    void setLatencyCsv(const std::string& path);
+    void setRenderScale(float scale);               // Fix the world's render scale (0.5 to 1) instead of adapting it
+    void setCpuRenderer(bool enabled);              // Call before init(); world drawn by SoftwareRasterizer
+    bool benchmarkRenderer(int frames) const;       // Instead of init(); compare CPU renderers and return
+    void setRecordPath(const std::string& path);    // Save each run as a replay
+    void setCapturePath(const std::string& path);   // Call before init(); Y4M, or raw I420 for ".yuv"
+    void setHeadless(bool enabled);                 // Call before init()
+    // Play a recorded run after init(), speed in ticks per frame, starting at startSeconds
+    bool startReplay(const std::string& path, float speed = 1.0f, float startSeconds = 0.0f);
+    void runHeadless();                             // Play the replay to the end without rendering
+    // Play a scripted run through update() and render() for frames measured frames and compare
+    // the frame times, allocations and draw calls with the baseline file (or write it)
+    bool runPerfGate(int frames, const std::string& baselinePath, bool updateBaseline);
+    void setAutopilot(bool enabled);                // The autopilot steers every run
+    // Play `games` autopilot runs from consecutive seeds without rendering and print how far they got
+    void runSoak(int games);
+    bool didReplayDiverge() const;
+    // The whole run (map, player, entities, spawn state) as a flat byte buffer, replacing out.
+    // Loading one resumes play from it.
+    void saveSnapshot(std::vector<uint8_t>& out);
+    bool loadSnapshot(const uint8_t* data, size_t size);
+    const SnapshotStats& getSnapshotStats() const;
+    const InputLatencyTracker& getInputLatency() const;
+    void setStrictAllocations(bool strict); // Needs a TRACK_ALLOCATIONS build
+    bool didAllocationCheckFail() const;
+    const FrameAllocations& getLastFrameAllocations() const;
+    const std::vector<StartupPhase>& getStartupPhases() const;
+    bool buildAssetPack(const std::string& packPath) const; // Pre-decode all assets into a pack
     void run();
 
     // Menu control methods
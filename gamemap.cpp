@@ -1,33 +1,66 @@
 #include "gamemap.h"
+#include "jobsystem.h"
+#include "gridmath.h"
 #include <cmath> // For fmod
+#include <algorithm>
 
-GameMap::GameMap() : 
-    totalRows(GRID_ROWS + BUFFER_ROWS),
+// Bitmask with bits first..last set, matching RowOccupancy column layout
+static uint32_t columnSpanMask(int first, int last) {
+    return static_cast<uint32_t>(((uint64_t(1) << (last - first + 1)) - 1) << first);
+}
+
+GameMap::GameMap() : GameMap(std::random_device()()) {
+}
+
+GameMap::GameMap(unsigned int seed) : 
+    cellPool(MAP_ROWS * GRID_COLS),
+    totalRows(MAP_ROWS),
     scrollOffset(0.0f),
     scrolledRows(0),
+    lastScrollDelta(0.0f),
+    seed(0),
+    generatedRows(0),
     difficultyLevel(1),
-    finishLineGenerated(false) {
-    
-    // Initialize random number generator
-    std::random_device rd;
-    rng = std::mt19937(rd());
+    finishLineGenerated(false),
+    parallel(false) {
     
     // Initialize grid with empty cells
     grid.resize(totalRows);
     for (auto& row : grid) {
         row.resize(GRID_COLS);
-        for (int col = 0; col < GRID_COLS; col++) {
-            row[col] = nullptr;
-        }
     }
+    occupancy.resize(totalRows);
+    reset(seed);
+}
+
+void GameMap::reset(unsigned int mapSeed) {
+    // Rows seed the generator themselves from this
+    seed = mapSeed;
+    generatedRows = 0;
+    
+    scrollOffset = 0.0f;
+    scrolledRows = 0;
+    lastScrollDelta = 0.0f;
+    difficultyLevel = 1;
+    finishLineGenerated = false;
+    
+    for (int row = 0; row < totalRows; ++row) {
+        recycleRow(row);
+    }
+    occupancy.assign(totalRows, RowOccupancy{0, 0, false});
     
     // Generate initial map
-    void initRows();
+    initRows();
 }
 
-void GameMap::update() {
+void GameMap::setParallel(bool enabled) {
+    parallel = enabled;
+}
+
+void GameMap::update(float scrollDistance) {
     // Update scroll offset
-    scrollOffset += SCROLL_SPEED;
+    scrollOffset += scrollDistance;
+    lastScrollDelta = scrollDistance;
     
     // Check if we need to shift rows
     if (scrollOffset >= GRID_SIZE) {
@@ -47,107 +80,165 @@ void GameMap::update() {
         }*/
     }
     
-    // Update all cells in the grid
-    for (auto& row : grid) {
-        for (auto& cell : row) {
-            if (cell) {
-                cell->update();             //until now there nothing to update
+    // Update all cells in the grid (animation frames). Rows are independent, so
+    // chunks of rows can run on the job system. Row generation above stays serial
+    // because each row depends on the previous row's occupancy; the generator is
+    // reseeded per row, so it is not shared state.
+    auto updateRows = [this](int firstRow, int lastRow) {
+        for (int row = firstRow; row < lastRow; ++row) {
+            for (auto& cell : grid[row]) {
+                if (cell) {
+                    cell->update();
+                }
             }
         }
+    };
+    if (parallel) {
+        TheJobSystem::Instance()->parallelFor(0, totalRows, MAP_UPDATE_ROWS_PER_JOB, updateRows);
+    } else {
+        updateRows(0, totalRows);
     }
 }
 
 void GameMap::render(SDL_Renderer* renderer) const {
+    // Default camera covers the renderer's whole viewport at 1:1 scale
+    SDL_Rect viewport;
+    SDL_RenderGetViewport(renderer, &viewport);
+    SDL_Rect camera = {0, 0, viewport.w, viewport.h};
+    render(renderer, camera);
+}
+
+void GameMap::render(SDL_Renderer* renderer, const SDL_Rect& camera) const {
+    SDL_Rect viewport;
+    SDL_RenderGetViewport(renderer, &viewport);
+    if (camera.w <= 0 || camera.h <= 0 || viewport.w <= 0 || viewport.h <= 0) {
+        return;
+    }
+
     // Convert scrollOffset to integer for rendering
     int intScrollOffset = static_cast<int>(scrollOffset);
 
-    // Draw grid cells
-    for (int row = 0; row < totalRows; ++row) {
-        // Calculate screen Y position
-        int screenY = row * GRID_SIZE + intScrollOffset;
-        
-        // Only draw rows that are visible
-        if (screenY < SCREEN_HEIGHT) {                         //screenY + GRID_SIZE > 0 &&
-            for (int col = 0; col < GRID_COLS; ++col) {
-                if (grid[row][col]) {
-                    // Calculate screen position
-                    SDL_Rect tempRect = {
-                        col * GRID_SIZE, //x
-                        screenY,         //y
-                        GRID_SIZE,       //w
-                        GRID_SIZE        //h
-                    };
-                    
-                    Cell* cell = dynamic_cast<Cell*>(grid[row][col].get());
-                    if (cell && !cell->isCollected() && !cell->getTextureID().empty()) {
-                        cell->render(renderer, tempRect);
-                    }
-                    
-                    /*else {
-                        // Fallback to default rendering (optional, but provides safety)
-                        SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-                        SDL_RenderDrawRect(renderer, &tempRect);
-                    }*/
-                    }
+    // Only the rows and columns the camera can see are visited, so the cost
+    // follows the screen size rather than totalRows
+    int firstRow = std::max(0, floorDiv(camera.y - intScrollOffset, GRID_SIZE));
+    int lastRow = std::min(totalRows - 1, floorDiv(camera.y + camera.h - 1 - intScrollOffset, GRID_SIZE));
+    int firstCol = std::max(0, floorDiv(camera.x, GRID_SIZE));
+    int lastCol = std::min(GRID_COLS - 1, floorDiv(camera.x + camera.w - 1, GRID_SIZE));
+
+    // Command lists come from the frame arena and are handed back once submitted
+    FrameArena* arena = TheFrameArena::Instance();
+    size_t arenaMarker = arena->mark();
+    int visibleRows = lastRow - firstRow + 1;
+    if (visibleRows <= 0) {
+        return;
+    }
+    RenderCommand* renderCommands = arena->allocateArray<RenderCommand>(visibleRows * GRID_COLS);
+    int* rowCommandCounts = arena->allocateArray<int>(visibleRows);
+    if (!renderCommands || !rowCommandCounts) {
+        arena->rewind(arenaMarker);
+        return;
+    }
+
+    // Build draw commands for chunks of rows (in parallel when enabled), then
+    // submit them here in row order so the result matches a serial draw
+    auto buildRows = [&](int rowBegin, int rowEnd) {
+        for (int row = rowBegin; row < rowEnd; ++row) {
+            // Map world space to the viewport; edges are computed per cell so
+            // neighbouring cells never leave gaps when the camera is scaled
+            int worldY = row * GRID_SIZE + intScrollOffset - camera.y;
+            int screenY = worldY * viewport.h / camera.h;
+            int screenH = (worldY + GRID_SIZE) * viewport.h / camera.h - screenY;
+            
+            RenderCommand* commands = &renderCommands[(row - firstRow) * GRID_COLS];
+            int count = 0;
+            for (int col = firstCol; col <= lastCol; ++col) {
+                const Cell* cell = grid[row][col];
+                if (!cell) {
+                    continue;
+                }
+                
+                int worldX = col * GRID_SIZE - camera.x;
+                int screenX = worldX * viewport.w / camera.w;
+                SDL_Rect tempRect = {
+                    screenX,                                                //x
+                    screenY,                                                //y
+                    (worldX + GRID_SIZE) * viewport.w / camera.w - screenX, //w
+                    screenH                                                 //h
+                };
+                if (cell->buildRenderCommand(tempRect, commands[count])) {
+                    ++count;
                 }
             }
+            rowCommandCounts[row - firstRow] = count;
         }
+    };
+    
+    if (parallel) {
+        TheJobSystem::Instance()->parallelFor(firstRow, lastRow + 1, MAP_RENDER_ROWS_PER_JOB, buildRows);
+    } else {
+        buildRows(firstRow, lastRow + 1);
+    }
+    
+    for (int row = 0; row < visibleRows; ++row) {
+        TheTextureManager::Instance()->submit(&renderCommands[row * GRID_COLS], rowCommandCounts[row], renderer);
+    }
+    arena->rewind(arenaMarker);
 }
 
 void GameMap::shiftRowsDown() {
-    // Remove bottom row
-    grid.pop_back();
-    
-    // Add new row at top
-    std::vector<std::unique_ptr<Cell>> newRow(GRID_COLS);
-    for (int i = 0; i < GRID_COLS; i++) {
-        newRow[i] = nullptr;
-    }
-    grid.insert(grid.begin(), std::move(newRow));
+    // Rotate the bottom row round to the top and clear it, reusing its storage
+    recycleRow(totalRows - 1);
+    std::rotate(grid.begin(), grid.end() - 1, grid.end());
+    std::rotate(occupancy.begin(), occupancy.end() - 1, occupancy.end());
+    occupancy[0] = RowOccupancy{0, 0, false};
     
     // Generate content for new row
     generateRow(0);
 }
 
 void GameMap::initRows(){
-    for (int i = 0; i < totalRows; ++i) {
-        generateRow(i);
+    // Fill the buffer rows above the screen and leave the screen clear for the player's start.
+    // Bottom up, so each row sees the one below it as when scrolling.
+    for (int row = BUFFER_ROWS - 1; row >= 0; --row) {
+        generateRow(row);
     }
-    for (int i = totalRows - static_cast<int>(totalRows-10); i < totalRows; ++i) {
-        for (int col = 0; col < GRID_COLS; ++col) {
-            grid[i][col]->setType(CellType::EMPTY);
-        }
+}
+
+Cell* GameMap::makeCell(CellType type, int col, int row) {
+    // Never fails: the pool holds as many cells as the grid has slots
+    return cellPool.create(type, col * GRID_SIZE, row * GRID_SIZE, GRID_SIZE, GRID_SIZE);
+}
+
+void GameMap::recycleRow(int row) {
+    for (Cell*& cell : grid[row]) {
+        cellPool.destroy(cell);
+        cell = nullptr;
     }
 }
 
 void GameMap::generateRow(int rowIndex) {
+    // Each row gets its own seeding, so a saved map resumes generation from the row count
+    // alone instead of carrying the generator's whole state
+    rng.seed(seed ^ (generatedRows * 0x9E3779B9u));
+    ++generatedRows;
 
     // Calculate if this should be the finish line
     bool isFinishLine = !finishLineGenerated && scrolledRows > MAX_ROWS && rowIndex == 0;
     
+    RowOccupancy& rowOccupancy = occupancy[rowIndex];
+    rowOccupancy = RowOccupancy{0, 0, false};
+    
     if (isFinishLine) {
         for (int col = 0; col < GRID_COLS; ++col) {
-            grid[rowIndex][col] = std::make_unique<Cell>(
-                CellType::FINISH, 
-                col * GRID_SIZE, 
-                rowIndex * GRID_SIZE, 
-                GRID_SIZE, 
-                GRID_SIZE
-            );
+            grid[rowIndex][col] = makeCell(CellType::FINISH, col, rowIndex);
         }
+        rowOccupancy.finish = true;
         finishLineGenerated = true;
         return;
     }
     
     // Previous row analysis for path continuity
-    std::vector<bool> previousObstacles(GRID_COLS, false);
-    if (rowIndex < totalRows - 1) {
-        for (int col = 0; col < GRID_COLS; ++col) {
-            if (grid[rowIndex + 1][col] && dynamic_cast<Cell*>(grid[rowIndex + 1][col].get())->getType() == CellType::OBSTACLE) {
-                previousObstacles[col] = true;
-            }
-        }
-    }
+    uint32_t previousObstacles = (rowIndex < totalRows - 1) ? occupancy[rowIndex + 1].obstacles : 0;
     
     // Generate new row with procedural content
     std::uniform_int_distribution<int> obstacleChance(1, 100);
@@ -165,7 +256,7 @@ void GameMap::generateRow(int rowIndex) {
             // Obstacle probability increases with difficulty
             int obstacleThreshold = 95 - difficultyLevel * 3;
             // Reduce obstacles if there was one in the previous row at this position (avoid walls)
-            if (previousObstacles[col]) {
+            if (previousObstacles & (1u << col)) {
                 obstacleThreshold += 10;
             }
             
@@ -181,64 +272,211 @@ void GameMap::generateRow(int rowIndex) {
         
         // Create the game object
         if (cellType != CellType::EMPTY) {
-            grid[rowIndex][col] = std::make_unique<Cell>(
-                cellType, 
-                col * GRID_SIZE, 
-                rowIndex * GRID_SIZE, 
-                GRID_SIZE, 
-                GRID_SIZE
-            );
+            grid[rowIndex][col] = makeCell(cellType, col, rowIndex);
+            if (cellType == CellType::OBSTACLE) {
+                rowOccupancy.obstacles |= 1u << col;
+            } else {
+                rowOccupancy.coins |= 1u << col;
+            }
         }
     }
 }
 
-bool GameMap::checkCollision(const SDL_Rect& playerRect, int& points) {
-    // Calculate grid coordinates from player position
+bool GameMap::cellOverlaps(int row, int col, const SDL_Rect& playerRect, const CollisionMask* playerMask, int sweep) const {
+    // Broad phase already established that the rects meet; refine with masks when both sides have one
+    if (!playerMask) {
+        return true;
+    }
+    const CollisionMask* cellMask = grid[row][col] ? grid[row][col]->getCollisionMask() : nullptr;
+    if (!cellMask) {
+        return true;
+    }
+    return masksOverlap(*playerMask, playerRect.x, playerRect.y,
+                        *cellMask, col * GRID_SIZE, row * GRID_SIZE + static_cast<int>(scrollOffset), sweep);
+}
+
+bool GameMap::checkCollision(const SDL_Rect& playerRect, int& points, const CollisionMask* playerMask) {
+    CollisionResult result;
+    queryCollisions(&playerRect, 1, &result, &playerMask);
+    points += applyPickups(result);
+    return result.hitObstacle;
+}
+
+void GameMap::queryCollisions(const SDL_Rect* rects, size_t count, CollisionResult* results,
+                              const CollisionMask* const* masks) const {
+    // Shared by every query in the batch
     int screenOffset = static_cast<int>(scrollOffset);
     
-    // These are approximate grid cell coordinates
-
-    int startRow = std::max(0, (playerRect.y - screenOffset) / GRID_SIZE);
-    int endRow = std::min(totalRows - 1, (playerRect.y + playerRect.h - screenOffset) / GRID_SIZE);
-    int startCol = std::max(0, playerRect.x / GRID_SIZE);
-    int endCol = std::min(GRID_COLS - 1, (playerRect.x + playerRect.w) / GRID_SIZE);
-    
-    bool hitObstacle = false;
-    
-    // Check all potentially overlapping cells
-    for (int row = startRow; row <= endRow; ++row) {
-        for (int col = startCol; col <= endCol; ++col) {
-            if (grid[row][col] && grid[row][col]->isActive() && 
-                !dynamic_cast<Cell*>(grid[row][col].get())->isCollected()) {
-                // Calculate screen position of this cell
-                SDL_Rect cellRect = {
-                    col * GRID_SIZE,
-                    row * GRID_SIZE + screenOffset,
-                    GRID_SIZE,
-                    GRID_SIZE
-                };
-                
-                // Check precise collision
-                if (SDL_HasIntersection(&playerRect, &cellRect)) {
-                    CellType type = dynamic_cast<Cell*>(grid[row][col].get())->getType();
-                    
-                    if (type == CellType::OBSTACLE) {
-                        hitObstacle = true;
-                    } else if (type == CellType::COIN) {
-                        dynamic_cast<Cell*>(grid[row][col].get())->collect();
-                        points += 10;
-                    } else if (type == CellType::FINISH) {
-                        points += 1000; // Bonus for finishing
-                        return false;  // Successfully reaching the finish line isn't a collision
-                    }
+    // The rows slid down by lastScrollDelta since the previous check, so relative to
+    // the current grid the player covered everything from its rect down to that far
+    // below it. Testing the swept span keeps fast scrolling from tunnelling.
+    int sweep = std::max(0, static_cast<int>(std::ceil(lastScrollDelta)));
+    
+    for (size_t i = 0; i < count; ++i) {
+        const SDL_Rect& playerRect = rects[i];
+        const CollisionMask* playerMask = masks ? masks[i] : nullptr;
+        CollisionResult& result = results[i];
+        result.hitObstacle = false;
+        result.reachedFinish = false;
+        result.firstRow = 0;
+        result.rowCount = 0;
+        
+        int startRow = std::max(0, floorDiv(playerRect.y - screenOffset, GRID_SIZE));
+        int endRow = std::min(totalRows - 1, floorDiv(playerRect.y + playerRect.h + sweep - 1 - screenOffset, GRID_SIZE));
+        int startCol = std::max(0, floorDiv(playerRect.x, GRID_SIZE));
+        int endCol = std::min(GRID_COLS - 1, floorDiv(playerRect.x + playerRect.w - 1, GRID_SIZE));
+        if (startCol > endCol || startRow > endRow || playerRect.h <= 0) {
+            continue;
+        }
+        
+        // Columns overlapped by the player, as a mask comparable with RowOccupancy
+        uint32_t playerCols = columnSpanMask(startCol, endCol);
+        result.firstRow = startRow;
+        
+        for (int row = startRow; row <= endRow; ++row) {
+            const RowOccupancy& rowOccupancy = occupancy[row];
+            
+            uint32_t touchedObstacles = result.hitObstacle ? 0 : (rowOccupancy.obstacles & playerCols);
+            for (int col = startCol; touchedObstacles != 0 && col <= endCol; ++col) {
+                if ((touchedObstacles & (1u << col)) && cellOverlaps(row, col, playerRect, playerMask, sweep)) {
+                    result.hitObstacle = true;
+                    break;
+                }
+            }
+            
+            uint32_t touchedCoins = rowOccupancy.coins & playerCols;
+            uint32_t coinMask = 0;
+            for (int col = startCol; touchedCoins != 0 && col <= endCol; ++col) {
+                if ((touchedCoins & (1u << col)) && cellOverlaps(row, col, playerRect, playerMask, sweep)) {
+                    coinMask |= 1u << col;
                 }
             }
+            result.coinMasks[result.rowCount++] = coinMask;
+            
+            if (rowOccupancy.finish) {
+                // Successfully reaching the finish line isn't a collision
+                result.reachedFinish = true;
+                result.hitObstacle = false;
+                break;
+            }
+        }
+    }
+}
+
+int GameMap::applyPickups(const CollisionResult& result) {
+    int points = 0;
+    
+    for (int i = 0; i < result.rowCount; ++i) {
+        int row = result.firstRow + i;
+        uint32_t coins = result.coinMasks[i] & occupancy[row].coins;
+        for (int col = 0; coins != 0 && col < GRID_COLS; ++col) {
+            if (coins & (1u << col)) {
+                grid[row][col]->collect();
+                coins &= ~(1u << col);
+                points += 10;
+            }
         }
+        occupancy[row].coins &= ~result.coinMasks[i];
+    }
+    
+    if (result.reachedFinish) {
+        points += 1000; // Bonus for finishing
     }
     
-    return hitObstacle;
+    return points;
+}
+
+SDL_Rect GameMap::getCellRect(int row, int col) const {
+    return SDL_Rect{col * GRID_SIZE, row * GRID_SIZE + static_cast<int>(scrollOffset), GRID_SIZE, GRID_SIZE};
+}
+
+const RowOccupancy* GameMap::getRowAt(int screenY) const {
+    int row = floorDiv(screenY - static_cast<int>(scrollOffset), GRID_SIZE);
+    if (row < 0 || row >= totalRows) {
+        return nullptr;
+    }
+    return &occupancy[row];
 }
 
 int GameMap::getScrolledRows() const {
     return scrolledRows;
+}
+
+float GameMap::getScrollPosition() const {
+    return static_cast<float>(scrolledRows * GRID_SIZE) + scrollOffset;
+}
+
+void GameMap::saveState(StateWriter& writer) const {
+    writer.write(seed);
+    writer.write(generatedRows);
+    writer.write(scrollOffset);
+    writer.write(static_cast<int32_t>(scrolledRows));
+    writer.write(lastScrollDelta);
+    writer.write(static_cast<int32_t>(difficultyLevel));
+    writer.write(static_cast<uint8_t>(finishLineGenerated));
+    
+    // Per row: occupancy, then a column mask of the cells present followed by each cell
+    for (int row = 0; row < totalRows; ++row) {
+        const RowOccupancy& rowOccupancy = occupancy[row];
+        writer.write(rowOccupancy.obstacles);
+        writer.write(rowOccupancy.coins);
+        writer.write(static_cast<uint8_t>(rowOccupancy.finish));
+        
+        uint32_t present = 0;
+        for (int col = 0; col < GRID_COLS; ++col) {
+            if (grid[row][col]) {
+                present |= 1u << col;
+            }
+        }
+        writer.write(present);
+        for (int col = 0; col < GRID_COLS; ++col) {
+            if (grid[row][col]) {
+                grid[row][col]->saveState(writer);
+            }
+        }
+    }
+}
+
+bool GameMap::loadState(StateReader& reader) {
+    int32_t savedScrolledRows, savedDifficulty;
+    uint8_t savedFinish;
+    if (!reader.read(seed) || !reader.read(generatedRows) || !reader.read(scrollOffset) ||
+        !reader.read(savedScrolledRows) || !reader.read(lastScrollDelta) ||
+        !reader.read(savedDifficulty) || !reader.read(savedFinish)) {
+        return false;
+    }
+    scrolledRows = savedScrolledRows;
+    difficultyLevel = savedDifficulty;
+    finishLineGenerated = savedFinish != 0;
+    
+    for (int row = 0; row < totalRows; ++row) {
+        recycleRow(row);
+    }
+    for (int row = 0; row < totalRows; ++row) {
+        RowOccupancy& rowOccupancy = occupancy[row];
+        uint8_t finish;
+        uint32_t present;
+        if (!reader.read(rowOccupancy.obstacles) || !reader.read(rowOccupancy.coins) ||
+            !reader.read(finish) || !reader.read(present)) {
+            return false;
+        }
+        rowOccupancy.finish = finish != 0;
+        if (present >> GRID_COLS) {
+            reader.fail();
+            return false;
+        }
+        for (int col = 0; col < GRID_COLS; ++col) {
+            if (present & (1u << col)) {
+                grid[row][col] = makeCell(CellType::EMPTY, col, row);
+                if (!grid[row][col]->loadState(reader, col * GRID_SIZE, row * GRID_SIZE)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+AllocatorStats GameMap::getCellPoolStats() const {
+    return cellPool.getStats();
 }
\ No newline at end of file
@@ -4,20 +4,49 @@
 #include <vector>
 #include <random>
 #include <memory>
+#include <cstdint>
 #include "gameobject.h"
 #include "texturemanager.h"
+#include "allocators.h"
+
+// Column bitmasks for one grid row, kept in step with the grid so collision can
+// test whole rows at once instead of visiting individual cells
+struct RowOccupancy {
+    uint32_t obstacles;
+    uint32_t coins;         // Uncollected coins only
+    bool finish;
+};
+
+static_assert(GRID_COLS <= 32, "RowOccupancy column masks hold at most 32 columns");
+
+// Outcome of one collision query. Touched coins are only reported here;
+// GameMap::applyPickups collects them. Row indices are valid until the next update().
+struct CollisionResult {
+    bool hitObstacle;
+    bool reachedFinish;
+    int firstRow;                   // Grid row of coinMasks[0]
+    int rowCount;                   // Number of valid entries in coinMasks
+    uint32_t coinMasks[MAP_ROWS];   // Coins touched per row, as column bits
+};
 
 class GameMap {
 private:
 
-    std::vector<std::vector<std::unique_ptr<Cell>>> grid;
+    // Cells live in cellPool, sized for a full grid, so scrolling never allocates
+    Pool<Cell> cellPool;
+    std::vector<std::vector<Cell*>> grid;
+    std::vector<RowOccupancy> occupancy;
     
     int totalRows;
     float scrollOffset;  // Fraction of a grid cell (0.0 to GRID_SIZE)
     int scrolledRows;    // Track total rows scrolled for level progression
+    float lastScrollDelta; // Pixels scrolled by the last update(), swept by checkCollision
     std::mt19937 rng;
+    uint32_t seed;
+    uint32_t generatedRows; // Rows generated since reset; seeds the next row (see generateRow)
     int difficultyLevel;
     bool finishLineGenerated;
+    bool parallel;       // Spread per-frame work over the job system
     
     // Texture IDs for different cell types
     const std::string OBSTACLE_TEXTURE_ID = "obstacle";
@@ -25,15 +54,46 @@ private:
     const std::string FINISH_TEXTURE_ID = "finish";
 
     void generateRow(int rowIndex);
+    Cell* makeCell(CellType type, int col, int row);
+    void recycleRow(int row);
     void shiftRowsDown();
     void initRows();
+    bool cellOverlaps(int row, int col, const SDL_Rect& playerRect, const CollisionMask* playerMask, int sweep) const;
 
 public:
     GameMap();
-    void update();
+    explicit GameMap(unsigned int seed);
+    // Clear the map in place and generate the rows above the screen from seed. Doesn't allocate,
+    // and only touches this map, so the next run's map can be prepared on another thread.
+    void reset(unsigned int seed);
+    // Run cell updates and render command building on the job system
+    void setParallel(bool enabled);
+    void update(float scrollDistance = SCROLL_SPEED);
     void render(SDL_Renderer* renderer) const;
-    bool checkCollision(const SDL_Rect& playerRect, int& points);
+    // Render the part of the map seen by camera (screen space) scaled into the renderer's viewport
+    void render(SDL_Renderer* renderer, const SDL_Rect& camera) const;
+    // playerMask enables the pixel-exact narrow phase; without it cells collide as full squares
+    bool checkCollision(const SDL_Rect& playerRect, int& points, const CollisionMask* playerMask = nullptr);
+    // Test count rects against the map without changing it. masks is optional and
+    // parallel to rects; results must hold count entries.
+    void queryCollisions(const SDL_Rect* rects, size_t count, CollisionResult* results,
+                         const CollisionMask* const* masks = nullptr) const;
+    // Collect the coins a query touched and return the points earned (finish bonus included).
+    // Coins already taken by an earlier pickup in the same tick are not counted twice.
+    int applyPickups(const CollisionResult& result);
+    // Screen rect of the cell at grid row and column
+    SDL_Rect getCellRect(int row, int col) const;
+    // Occupancy of the row drawn at screenY, or nullptr outside the map
+    const RowOccupancy* getRowAt(int screenY) const;
     int getScrolledRows() const;
+    // Total distance scrolled in pixels, including the part-row scroll offset
+    float getScrollPosition() const;
+    AllocatorStats getCellPoolStats() const;
+    
+    // Everything needed to continue the map exactly: cells, scroll, generator position
+    void saveState(StateWriter& writer) const;
+    // On failure the map is left partly loaded; reset() it before use
+    bool loadState(StateReader& reader);
 };
 
 #endif
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "gameobject.h"
+#include "drawstats.h"
 
 // GameObject implementation
 GameObject::GameObject(int x, int y, int w, int h, const std::string ID, int frame, int speed) 
@@ -35,6 +36,14 @@ const std::string& GameObject::getTextureID() const {
     return textureID;
 }
 
+int GameObject::getCurrentFrame() const {
+    return currentFrame;
+}
+
+const CollisionMask* GameObject::getCollisionMask() const {
+    return TheTextureManager::Instance()->getCollisionMask(textureID, 0, currentFrame);
+}
+
 void GameObject::update() {
     // Update animation frame
     frameCounter++;
@@ -51,7 +60,21 @@ Cell::Cell(CellType t, int x, int y, int w, int h)
     : GameObject(x, y, w, h, "", 1, 0), 
     type(t), 
     collected(false) {
-    // Set appropriate texture ID based on cell type
+    reset(t, x, y);
+}
+
+void Cell::reset(CellType t, int x, int y) {
+    rect.x = x;
+    rect.y = y;
+    type = t;
+    collected = false;
+    active = true;
+    currentFrame = 0;
+    frameCounter = 0;
+    frameCount = 1;
+    animationSpeed = 0;
+    
+    // Set appropriate texture ID based on cell type (short IDs fit the string's inline buffer)
     switch (type) {
         case CellType::OBSTACLE:
             setTextureID("obstacle");
@@ -83,10 +106,10 @@ void Cell::render(SDL_Renderer* renderer, const SDL_Rect& destRect) const {
         // Use sprite sheet rendering
         TheTextureManager::Instance()->drawFrame(
             textureID, 
-            destRect.x, destRect.y, 
-            destRect.w, destRect.h, 
+            rect.w, rect.h,     // frame size in the sprite sheet
             0,                  // row 0
             currentFrame, 
+            destRect,
             renderer
         );
     } 
@@ -98,6 +121,7 @@ void Cell::render(SDL_Renderer* renderer, const SDL_Rect& destRect) const {
         switch (type) {
             case CellType::OBSTACLE:
                 SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255); // Red for obstacles
+                countDrawCall();
                 SDL_RenderFillRect(renderer, &rect);
                 break;
             case CellType::COIN:
@@ -120,6 +144,7 @@ void Cell::render(SDL_Renderer* renderer, const SDL_Rect& destRect) const {
                 break;
             case CellType::FINISH:
                 SDL_SetRenderDrawColor(renderer, 0, 255, 0, 255); // Green for finish
+                countDrawCall();
                 SDL_RenderFillRect(renderer, &rect);
                 break;
             default:
@@ -128,6 +153,22 @@ void Cell::render(SDL_Renderer* renderer, const SDL_Rect& destRect) const {
     }
 }
 
+bool Cell::buildRenderCommand(const SDL_Rect& destRect, RenderCommand& command) const {
+    if (!active || collected || textureID.empty()) {
+        return false;
+    }
+    
+    command.texture = TheTextureManager::Instance()->findTexture(textureID);
+    if (command.texture == nullptr) {
+        return false;
+    }
+    
+    // Same sprite sheet frame as render(): row 0, current animation frame
+    command.srcRect = {rect.w * currentFrame, 0, rect.w, rect.h};
+    command.destRect = destRect;
+    return true;
+}
+
 CellType Cell::getType() const {
     return type;
 }
@@ -153,6 +194,31 @@ std::string& Cell::getTextureID()
     return textureID;
 }
 
+void Cell::saveState(StateWriter& writer) const {
+    // Frames and counters are small, so a byte each keeps map keyframes compact
+    writer.write(static_cast<uint8_t>(type));
+    writer.write(static_cast<uint8_t>(collected));
+    writer.write(static_cast<uint8_t>(currentFrame));
+    writer.write(static_cast<uint8_t>(frameCounter));
+}
+
+bool Cell::loadState(StateReader& reader, int x, int y) {
+    uint8_t savedType, savedCollected, savedFrame, savedCounter;
+    if (!reader.read(savedType) || !reader.read(savedCollected) ||
+        !reader.read(savedFrame) || !reader.read(savedCounter)) {
+        return false;
+    }
+    if (savedType > static_cast<uint8_t>(CellType::FINISH)) {
+        reader.fail();
+        return false;
+    }
+    reset(static_cast<CellType>(savedType), x, y);
+    collected = savedCollected != 0;
+    currentFrame = savedFrame % frameCount;
+    frameCounter = savedCounter;
+    return true;
+}
+
 // Player implementation
 Player::Player(int x, int y)
     : GameObject(x, y, PLAYER_WIDTH, PLAYER_HEIGHT, "player", 6, 20), 
@@ -160,6 +226,16 @@ Player::Player(int x, int y)
       alive(true)
 {}
 
+void Player::reset(int x, int y) {
+    rect.x = x;
+    rect.y = y;
+    active = true;
+    currentFrame = 0;
+    frameCounter = 0;
+    score = 0;
+    alive = true;
+}
+
 void Player::render(SDL_Renderer* renderer) const {
     if (!active) return;
     
@@ -177,6 +253,7 @@ void Player::render(SDL_Renderer* renderer) const {
     else {
         // Fallback to original rendering
         SDL_SetRenderDrawColor(renderer, 0, 0, 255, 255); // Blue for player
+        countDrawCall();
         SDL_RenderFillRect(renderer, &rect);
     }
 }
@@ -211,3 +288,30 @@ void Player::kill() {
     alive = false;
 }
 
+void Player::saveState(StateWriter& writer) const {
+    writer.write(static_cast<int32_t>(rect.x));
+    writer.write(static_cast<int32_t>(rect.y));
+    writer.write(static_cast<int32_t>(score));
+    writer.write(static_cast<uint8_t>(currentFrame));
+    writer.write(static_cast<uint8_t>(frameCounter));
+    writer.write(static_cast<uint8_t>(active));
+    writer.write(static_cast<uint8_t>(alive));
+}
+
+bool Player::loadState(StateReader& reader) {
+    int32_t x, y, savedScore;
+    uint8_t savedFrame, savedCounter, savedActive, savedAlive;
+    if (!reader.read(x) || !reader.read(y) || !reader.read(savedScore) || !reader.read(savedFrame) ||
+        !reader.read(savedCounter) || !reader.read(savedActive) || !reader.read(savedAlive)) {
+        return false;
+    }
+    rect.x = x;
+    rect.y = y;
+    score = savedScore;
+    currentFrame = savedFrame % frameCount;
+    frameCounter = savedCounter;
+    active = savedActive != 0;
+    alive = savedAlive != 0;
+    return true;
+}
+
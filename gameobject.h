@@ -4,6 +4,7 @@
 #include <SDL2/SDL.h>
 #include "constants.h"
 #include "texturemanager.h"
+#include "serialize.h"
 
 // Abstract GameObject base class
 class GameObject {
@@ -34,6 +35,8 @@ public:
     bool checkCollision(const SDL_Rect& other) const;
     void setTextureID(const std::string& id);
     const std::string& getTextureID() const;
+    int getCurrentFrame() const;
+    const CollisionMask* getCollisionMask() const; // Mask of the current animation frame, if any
 };
 
 // Cell is a grid-based game object
@@ -44,9 +47,13 @@ private:
 
 public:
     Cell(CellType t, int x, int y, int w, int h);
+    // Reuse this cell as a fresh one of type t at (x, y)
+    void reset(CellType t, int x, int y);
 
     void render(SDL_Renderer* renderer) const override;
     void render(SDL_Renderer* renderer, const SDL_Rect& destRect) const override;
+    // Fill command with the draw for destRect; false when there is nothing to draw
+    bool buildRenderCommand(const SDL_Rect& destRect, RenderCommand& command) const;
     
     CellType getType() const;
     bool isCollected() const;
@@ -54,6 +61,10 @@ public:
     void setTextureID(const std::string& id);
     std::string& getTextureID();
     void setType(CellType t);
+    
+    // Type and animation state; the position comes from the map slot on load
+    void saveState(StateWriter& writer) const;
+    bool loadState(StateReader& reader, int x, int y);
 };
 
 // Player class
@@ -64,6 +75,7 @@ private:
 
 public:
     Player(int x, int y);
+    void reset(int x, int y);     // Back to a fresh run without reallocating
     
     void render(SDL_Renderer* renderer) const override;
     void render(SDL_Renderer* renderer, const SDL_Rect& destRect) const;
@@ -74,6 +86,9 @@ public:
     void addScore(int points);
     bool isAlive() const;
     void kill();
+    
+    void saveState(StateWriter& writer) const;
+    bool loadState(StateReader& reader);
    
 };
 
@@ -0,0 +1,14 @@
+#ifndef GRIDMATH_H
+#define GRIDMATH_H
+
+// Integer division rounding towards negative infinity, for mapping screen coordinates
+// (which go negative above the screen) to grid rows and buckets
+inline int floorDiv(int value, int divisor) {
+    int quotient = value / divisor;
+    if ((value % divisor != 0) && ((value < 0) != (divisor < 0))) {
+        --quotient;
+    }
+    return quotient;
+}
+
+#endif // GRIDMATH_H
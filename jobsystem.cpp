@@ -0,0 +1,302 @@
+#include "jobsystem.h"
+#include <chrono>
+#include <iostream>
+
+// Initialize static instance to nullptr
+JobSystem* JobSystem::instance = nullptr;
+
+// Index of the worker the current thread runs as; threads the job system did
+// not start (the main thread) act as worker 0
+static thread_local int currentWorker = 0;
+
+JobSystem* JobSystem::Instance() {
+    // Create instance if it doesn't exist
+    if (instance == nullptr) {
+        instance = new JobSystem();
+    }
+    return instance;
+}
+
+JobSystem::JobSystem()
+    : jobs(MAX_JOBS),
+      nextSlot(0),
+      queuedJobs(0),
+      stopping(false),
+      statsStart(std::chrono::steady_clock::now()) {
+    for (Job& job : jobs) {
+        job.generation.store(0);
+        job.pendingDependencies.store(0);
+        job.finished.store(true);
+        job.dependentCount = 0;
+    }
+}
+
+bool JobSystem::init(int workerCount) {
+    if (!queues.empty()) {
+        return true;
+    }
+
+    if (workerCount <= 0) {
+        workerCount = static_cast<int>(std::thread::hardware_concurrency());
+    }
+    if (workerCount < 1) {
+        workerCount = 1;
+    }
+
+    for (int i = 0; i < workerCount; ++i) {
+        auto queue = std::make_unique<WorkerQueue>();
+        queue->head = 0;
+        queue->count = 0;
+        queue->jobsRun.store(0);
+        queue->jobsStolen.store(0);
+        queue->busyNanoseconds.store(0);
+        queues.push_back(std::move(queue));
+    }
+
+    stopping = false;
+    currentWorker = 0;
+    for (int i = 1; i < workerCount; ++i) {
+        threads.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+
+    resetStats();
+    return true;
+}
+
+JobHandle JobSystem::submit(JobFunction function, void* data, int begin, int end,
+                            const JobHandle* dependencies, int dependencyCount) {
+    if (queues.empty()) {
+        init(1);
+    }
+
+    // Take the next slot; one still in use means MAX_JOBS are in flight, so help until it frees up
+    uint32_t slot = nextSlot.fetch_add(1) % MAX_JOBS;
+    Job& job = jobs[slot];
+    while (!job.finished.load(std::memory_order_acquire)) {
+        if (!tryRunJob(currentWorker)) {
+            std::this_thread::yield();
+        }
+    }
+
+    JobHandle handle;
+    {
+        std::lock_guard<std::mutex> lock(job.dependentsLock);
+        job.function = function;
+        job.data = data;
+        job.begin = begin;
+        job.end = end;
+        job.stolen = false;
+        job.dependentCount = 0;
+        // Held at one until every dependency is registered so the job can't start early
+        job.pendingDependencies.store(1);
+        job.finished.store(false);
+        handle.slot = slot;
+        handle.generation = job.generation.load() + 1;
+        job.generation.store(handle.generation);
+    }
+
+    for (int i = 0; i < dependencyCount; ++i) {
+        const JobHandle& dependency = dependencies[i];
+        Job& parent = jobs[dependency.slot];
+        bool registered = false;
+        {
+            std::lock_guard<std::mutex> lock(parent.dependentsLock);
+            if (parent.generation.load() == dependency.generation && !parent.finished.load() &&
+                parent.dependentCount < MAX_JOB_DEPENDENTS) {
+                parent.dependents[parent.dependentCount++] = slot;
+                job.pendingDependencies.fetch_add(1);
+                registered = true;
+            }
+        }
+        if (!registered && !isFinished(dependency.slot, dependency.generation)) {
+            // Dependent list is full; resolve the dependency here instead
+            wait(dependency);
+        }
+    }
+
+    if (job.pendingDependencies.fetch_sub(1) == 1) {
+        push(slot);
+    }
+    return handle;
+}
+
+void JobSystem::push(uint32_t slot) {
+    WorkerQueue& queue = *queues[currentWorker < static_cast<int>(queues.size()) ? currentWorker : 0];
+    {
+        std::lock_guard<std::mutex> lock(queue.lock);
+        queue.slots[(queue.head + queue.count) % MAX_JOBS] = slot;
+        ++queue.count;
+    }
+    queuedJobs.fetch_add(1);
+
+    if (!threads.empty()) {
+        // Taking the lock orders this push against a worker deciding to sleep
+        { std::lock_guard<std::mutex> lock(sleepLock); }
+        wakeCondition.notify_one();
+    }
+}
+
+bool JobSystem::tryRunJob(int worker) {
+    uint32_t slot = 0;
+    bool found = false;
+    bool stolen = false;
+
+    // Own queue first, newest job (still warm in cache)
+    {
+        WorkerQueue& queue = *queues[worker];
+        std::lock_guard<std::mutex> lock(queue.lock);
+        if (queue.count > 0) {
+            --queue.count;
+            slot = queue.slots[(queue.head + queue.count) % MAX_JOBS];
+            found = true;
+        }
+    }
+
+    // Otherwise steal the oldest job from another worker
+    int workerCount = static_cast<int>(queues.size());
+    for (int i = 1; !found && i < workerCount; ++i) {
+        WorkerQueue& victim = *queues[(worker + i) % workerCount];
+        std::lock_guard<std::mutex> lock(victim.lock);
+        if (victim.count > 0) {
+            slot = victim.slots[victim.head];
+            victim.head = (victim.head + 1) % MAX_JOBS;
+            --victim.count;
+            found = true;
+            stolen = true;
+        }
+    }
+
+    if (!found) {
+        return false;
+    }
+    queuedJobs.fetch_sub(1);
+
+    Job& job = jobs[slot];
+    auto start = std::chrono::steady_clock::now();
+    job.function(job.data, job.begin, job.end);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    WorkerQueue& self = *queues[worker];
+    self.busyNanoseconds.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+                                   std::memory_order_relaxed);
+    self.jobsRun.fetch_add(1, std::memory_order_relaxed);
+    if (stolen) {
+        self.jobsStolen.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    finish(slot);
+    return true;
+}
+
+void JobSystem::finish(uint32_t slot) {
+    Job& job = jobs[slot];
+    uint32_t ready[MAX_JOB_DEPENDENTS];
+    int readyCount;
+    {
+        std::lock_guard<std::mutex> lock(job.dependentsLock);
+        readyCount = job.dependentCount;
+        for (int i = 0; i < readyCount; ++i) {
+            ready[i] = job.dependents[i];
+        }
+        job.dependentCount = 0;
+        job.finished.store(true, std::memory_order_release);
+    }
+
+    for (int i = 0; i < readyCount; ++i) {
+        if (jobs[ready[i]].pendingDependencies.fetch_sub(1) == 1) {
+            push(ready[i]);
+        }
+    }
+}
+
+bool JobSystem::isFinished(uint32_t slot, uint32_t generation) const {
+    const Job& job = jobs[slot];
+    // A newer generation means the slot was recycled, which only happens after finishing
+    return job.generation.load(std::memory_order_acquire) != generation ||
+           job.finished.load(std::memory_order_acquire);
+}
+
+void JobSystem::wait(const JobHandle& handle) {
+    while (!isFinished(handle.slot, handle.generation)) {
+        if (!tryRunJob(currentWorker)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool JobSystem::runOneJob() {
+    if (queues.empty()) {
+        return false;
+    }
+    return tryRunJob(currentWorker);
+}
+
+void JobSystem::waitUntilZero(const std::atomic<int>& counter) {
+    while (counter.load(std::memory_order_acquire) > 0) {
+        if (!tryRunJob(currentWorker)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::workerLoop(int worker) {
+    currentWorker = worker;
+    while (!stopping.load()) {
+        if (tryRunJob(worker)) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepLock);
+        wakeCondition.wait(lock, [this]() { return stopping.load() || queuedJobs.load() > 0; });
+    }
+}
+
+int JobSystem::getWorkerCount() const {
+    return static_cast<int>(queues.size());
+}
+
+bool JobSystem::isSingleThreaded() const {
+    return threads.empty();
+}
+
+WorkerStats JobSystem::getWorkerStats(int worker) const {
+    WorkerStats stats = {};
+    if (worker < 0 || worker >= static_cast<int>(queues.size())) {
+        return stats;
+    }
+
+    const WorkerQueue& queue = *queues[worker];
+    stats.jobsRun = queue.jobsRun.load(std::memory_order_relaxed);
+    stats.jobsStolen = queue.jobsStolen.load(std::memory_order_relaxed);
+    stats.busySeconds = queue.busyNanoseconds.load(std::memory_order_relaxed) / 1e9;
+
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - statsStart).count();
+    stats.utilization = wallSeconds > 0.0 ? stats.busySeconds / wallSeconds : 0.0;
+    return stats;
+}
+
+void JobSystem::resetStats() {
+    for (auto& queue : queues) {
+        queue->jobsRun.store(0);
+        queue->jobsStolen.store(0);
+        queue->busyNanoseconds.store(0);
+    }
+    statsStart = std::chrono::steady_clock::now();
+}
+
+void JobSystem::clean() {
+    stopping = true;
+    {
+        std::lock_guard<std::mutex> lock(sleepLock);
+    }
+    wakeCondition.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    threads.clear();
+    queues.clear();
+
+    // Clean up the instance
+    delete instance;
+    instance = nullptr;
+}
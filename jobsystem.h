@@ -0,0 +1,159 @@
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Job entry point; data and the [begin, end) range are whatever the submitter passed
+typedef void (*JobFunction)(void* data, int begin, int end);
+
+// Identifies a submitted job for waiting or as a dependency. Slots are recycled,
+// so the generation tells a finished job apart from a newer one in the same slot.
+struct JobHandle {
+    uint32_t slot;
+    uint32_t generation;
+};
+
+// Per-worker counters since the last resetStats()
+struct WorkerStats {
+    uint64_t jobsRun;
+    uint64_t jobsStolen;       // Jobs this worker took from another worker's queue
+    double busySeconds;
+    double utilization;        // busySeconds / wall time since reset
+};
+
+const int MAX_JOBS                          = 4096; // Jobs in flight at once
+const int MAX_JOB_DEPENDENTS                = 16;   // Jobs that can wait on one job
+
+// Work-stealing scheduler. Worker 0 is the thread that calls init() (the main
+// thread); it runs jobs while it waits. Every worker owns a bounded deque: the
+// owner pushes and pops at the back, idle workers steal from the front.
+// Jobs live in a fixed slot pool, so submitting never allocates.
+// With one worker no threads are started and jobs run on the waiting thread in a
+// fixed order, which makes runs reproducible for determinism testing.
+class JobSystem {
+private:
+    static JobSystem* instance;
+
+    struct Job {
+        JobFunction function;
+        void* data;
+        int begin;
+        int end;
+        std::atomic<uint32_t> generation;
+        std::atomic<int> pendingDependencies;
+        std::atomic<bool> finished;
+        bool stolen;
+        std::mutex dependentsLock;
+        int dependentCount;
+        uint32_t dependents[MAX_JOB_DEPENDENTS];
+    };
+
+    struct WorkerQueue {
+        std::mutex lock;
+        uint32_t slots[MAX_JOBS];
+        int head;
+        int count;
+
+        std::atomic<uint64_t> jobsRun;
+        std::atomic<uint64_t> jobsStolen;
+        std::atomic<uint64_t> busyNanoseconds;
+    };
+
+    std::vector<Job> jobs;
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> threads;
+    std::atomic<uint32_t> nextSlot;
+    std::atomic<int> queuedJobs;
+    std::atomic<bool> stopping;
+    std::mutex sleepLock;
+    std::condition_variable wakeCondition;
+    std::chrono::steady_clock::time_point statsStart;
+
+    JobSystem();
+
+    void workerLoop(int worker);
+    void push(uint32_t slot);
+    bool tryRunJob(int worker);
+    void finish(uint32_t slot);
+    bool isFinished(uint32_t slot, uint32_t generation) const;
+
+    template <typename Body>
+    struct ForContext {
+        const Body* body;
+        std::atomic<int> remaining;
+    };
+
+    template <typename Body>
+    static void runForChunk(void* data, int begin, int end) {
+        ForContext<Body>* context = static_cast<ForContext<Body>*>(data);
+        (*context->body)(begin, end);
+        context->remaining.fetch_sub(1, std::memory_order_release);
+    }
+
+public:
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Get singleton instance
+    static JobSystem* Instance();
+
+    // Start workerCount - 1 threads; 0 uses one worker per hardware core, 1 is single-threaded
+    bool init(int workerCount = 0);
+
+    // Queue a job; it starts once every job in dependencies has finished.
+    // data must stay valid until the job has run.
+    JobHandle submit(JobFunction function, void* data, int begin = 0, int end = 0,
+                     const JobHandle* dependencies = nullptr, int dependencyCount = 0);
+
+    // Block until the job has finished, running other jobs meanwhile
+    void wait(const JobHandle& handle);
+
+    // Run one queued job on the calling thread; false if there was none
+    bool runOneJob();
+    
+    // Block until counter reaches zero, running other jobs meanwhile
+    void waitUntilZero(const std::atomic<int>& counter);
+
+    // Split [begin, end) into chunks of at most grain items and run body(chunkBegin, chunkEnd)
+    // on the workers. Returns once every chunk is done. Small ranges run inline.
+    template <typename Body>
+    void parallelFor(int begin, int end, int grain, const Body& body) {
+        if (grain < 1) {
+            grain = 1;
+        }
+        if (end - begin <= grain) {
+            if (end > begin) {
+                body(begin, end);
+            }
+            return;
+        }
+
+        ForContext<Body> context;
+        context.body = &body;
+        context.remaining.store((end - begin + grain - 1) / grain);
+        for (int chunk = begin; chunk < end; chunk += grain) {
+            submit(&JobSystem::runForChunk<Body>, &context, chunk, chunk + grain < end ? chunk + grain : end);
+        }
+        waitUntilZero(context.remaining);
+    }
+
+    int getWorkerCount() const;
+    bool isSingleThreaded() const;
+    WorkerStats getWorkerStats(int worker) const;
+    void resetStats();
+
+    // Stop worker threads
+    void clean();
+};
+
+// Shorthand for accessing the job system
+typedef JobSystem TheJobSystem;
+
+#endif // JOBSYSTEM_H
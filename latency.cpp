@@ -0,0 +1,132 @@
+#include "latency.h"
+#include <fstream>
+#include <iostream>
+
+LatencyHistogram::LatencyHistogram() {
+    clear();
+}
+
+void LatencyHistogram::record(double ms) {
+    int bucket = ms > 0.0 ? static_cast<int>(ms) : 0;
+    if (bucket >= LATENCY_BUCKETS) {
+        bucket = LATENCY_BUCKETS - 1;
+    }
+    ++buckets[bucket];
+    ++count;
+    totalMs += ms;
+    if (ms > maxMs) {
+        maxMs = ms;
+    }
+}
+
+void LatencyHistogram::clear() {
+    for (uint32_t& bucket : buckets) {
+        bucket = 0;
+    }
+    count = 0;
+    totalMs = 0.0;
+    maxMs = 0.0;
+}
+
+uint64_t LatencyHistogram::getCount() const {
+    return count;
+}
+
+uint32_t LatencyHistogram::getBucket(int bucket) const {
+    return buckets[bucket];
+}
+
+uint32_t LatencyHistogram::getLargestBucket() const {
+    uint32_t largest = 0;
+    for (uint32_t bucket : buckets) {
+        if (bucket > largest) {
+            largest = bucket;
+        }
+    }
+    return largest;
+}
+
+double LatencyHistogram::getAverage() const {
+    return count > 0 ? totalMs / count : 0.0;
+}
+
+double LatencyHistogram::getMax() const {
+    return maxMs;
+}
+
+double LatencyHistogram::getPercentile(double fraction) const {
+    if (count == 0) {
+        return 0.0;
+    }
+    uint64_t target = static_cast<uint64_t>(fraction * count);
+    uint64_t seen = 0;
+    for (int i = 0; i < LATENCY_BUCKETS - 1; ++i) {
+        seen += buckets[i];
+        if (seen > target) {
+            return i + 1.0;
+        }
+    }
+    return maxMs;
+}
+
+InputLatencyTracker::InputLatencyTracker() : pendingInput(0), applied(0) {
+}
+
+void InputLatencyTracker::onInput(Uint32 eventTimestamp) {
+    if (pendingInput != 0) {
+        return;
+    }
+    // SDL stamps events in milliseconds of SDL_GetTicks; move that onto the performance counter
+    Uint64 now = SDL_GetPerformanceCounter();
+    Uint32 ageMs = SDL_GetTicks() - eventTimestamp;
+    Uint64 age = static_cast<Uint64>(ageMs) * SDL_GetPerformanceFrequency() / 1000;
+    pendingInput = (eventTimestamp != 0 && age < now) ? now - age : now;
+}
+
+void InputLatencyTracker::onApplied() {
+    if (pendingInput != 0 && applied == 0) {
+        applied = SDL_GetPerformanceCounter();
+    }
+}
+
+void InputLatencyTracker::onPresented() {
+    if (pendingInput != 0 && applied != 0) {
+        Uint64 presented = SDL_GetPerformanceCounter();
+        double toMs = 1000.0 / SDL_GetPerformanceFrequency();
+        histograms[static_cast<int>(LatencyStage::INPUT_TO_APPLY)].record((applied - pendingInput) * toMs);
+        histograms[static_cast<int>(LatencyStage::APPLY_TO_PRESENT)].record((presented - applied) * toMs);
+        histograms[static_cast<int>(LatencyStage::INPUT_TO_PRESENT)].record((presented - pendingInput) * toMs);
+    }
+    pendingInput = 0;
+    applied = 0;
+}
+
+const LatencyHistogram& InputLatencyTracker::getHistogram(LatencyStage stage) const {
+    return histograms[static_cast<int>(stage)];
+}
+
+void InputLatencyTracker::clear() {
+    for (LatencyHistogram& histogram : histograms) {
+        histogram.clear();
+    }
+    pendingInput = 0;
+    applied = 0;
+}
+
+bool InputLatencyTracker::writeCsv(const std::string& fileName) const {
+    std::ofstream file(fileName);
+    if (!file) {
+        std::cerr << "Failed to open latency file: " << fileName << std::endl;
+        return false;
+    }
+
+    file << "bucket_ms,input_to_apply,apply_to_present,input_to_present\n";
+    for (int i = 0; i < LATENCY_BUCKETS; ++i) {
+        file << i;
+        for (const LatencyHistogram& histogram : histograms) {
+            file << "," << histogram.getBucket(i);
+        }
+        file << "\n";
+    }
+    return static_cast<bool>(file);
+}
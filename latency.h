@@ -0,0 +1,65 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <SDL2/SDL.h>
+#include <cstdint>
+#include <string>
+
+const int LATENCY_BUCKETS                   = 64;  // 1 ms each; the last also counts everything slower
+
+// Fixed-size latency histogram; recording never allocates
+class LatencyHistogram {
+private:
+    uint32_t buckets[LATENCY_BUCKETS];
+    uint64_t count;
+    double totalMs;
+    double maxMs;
+
+public:
+    LatencyHistogram();
+
+    void record(double ms);
+    void clear();
+
+    uint64_t getCount() const;
+    uint32_t getBucket(int bucket) const;
+    uint32_t getLargestBucket() const;
+    double getAverage() const;
+    double getMax() const;
+    // Upper edge of the bucket holding the given fraction of samples, in ms
+    double getPercentile(double fraction) const;
+};
+
+// The three intervals measured for steering input
+enum class LatencyStage {
+    INPUT_TO_APPLY,        // Key event until Player::moveLeft/moveRight ran
+    APPLY_TO_PRESENT,      // Move until the frame showing it was presented
+    INPUT_TO_PRESENT,
+    COUNT
+};
+
+// Follows steering key presses through the frame loop. The oldest key press not
+// yet applied is remembered until the frame that moves the player; presses in
+// frames that don't steer (menus, game over) are dropped.
+class InputLatencyTracker {
+private:
+    Uint64 pendingInput;       // Performance counter of the oldest unapplied press; 0 if none
+    Uint64 applied;            // When the pending press moved the player; 0 if not yet
+    LatencyHistogram histograms[static_cast<int>(LatencyStage::COUNT)];
+
+public:
+    InputLatencyTracker();
+
+    // eventTimestamp is the SDL event's millisecond timestamp
+    void onInput(Uint32 eventTimestamp);
+    void onApplied();
+    void onPresented();
+
+    const LatencyHistogram& getHistogram(LatencyStage stage) const;
+    void clear();
+
+    // One row per bucket with a column per stage
+    bool writeCsv(const std::string& fileName) const;
+};
+
+#endif // LATENCY_H
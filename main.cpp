@@ -1,10 +1,141 @@
 //main.cpp
 #include "game.h"
 #include "constants.h"
+#include "perfgate.h"
+#include "autopilot.h"
+#include "environment.h"
 #include <iostream>
+#include <cstring>
+#include <cstdlib>
 
 int main(int argc, char* argv[]) {
     Game game;
+    std::string replayPath;
+    float replaySpeed = 1.0f;
+    float replayStart = 0.0f;
+    bool headless = false;
+    int benchmarkFrames = 0;
+    int envBenchmarkSteps = 0;
+    int perfFrames = 0;
+    std::string perfBaseline = PERF_BASELINE_PATH;
+    bool perfUpdate = false;
+    int soakGames = 0;
+    
+    for (int i = 1; i < argc; ++i) {
+        // Run all job system work on the main thread for reproducible runs
+        if (std::strcmp(argv[i], "--single-threaded") == 0) {
+            game.setJobWorkers(1);
+        }
+        // Write the pre-decoded asset pack (optionally to the given path) and exit
+        else if (std::strcmp(argv[i], "--build-pack") == 0) {
+            std::string packPath = (i + 1 < argc) ? argv[i + 1] : ASSET_PACK_PATH;
+            return game.buildAssetPack(packPath) ? 0 : 1;
+        }
+        // Audio driver for SDL, e.g. "dummy" or "disk" to test without a sound card
+        else if (std::strcmp(argv[i], "--audio-driver") == 0 && i + 1 < argc) {
+            game.setAudioDriver(argv[++i]);
+        }
+        // Write steering input latency histograms to a CSV file on exit
+        else if (std::strcmp(argv[i], "--latency-csv") == 0 && i + 1 < argc) {
+            game.setLatencyCsv(argv[++i]);
+        }
+        // Record every run to a replay file
+        else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            game.setRecordPath(argv[++i]);
+        }
+        // Capture every presented frame to a Y4M video (raw I420 if FILE ends in .yuv)
+        else if (std::strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            game.setCapturePath(argv[++i]);
+        }
+        // Play back a recorded run, optionally faster or slower and from a given second
+        else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--replay-speed") == 0 && i + 1 < argc) {
+            replaySpeed = static_cast<float>(std::atof(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--replay-seek") == 0 && i + 1 < argc) {
+            replayStart = static_cast<float>(std::atof(argv[++i]));
+        }
+        // Play the replay to the end as fast as possible with no visible window
+        else if (std::strcmp(argv[i], "--headless") == 0) {
+            headless = true;
+        }
+        // Render the game world at a fixed fraction of the window size instead of adjusting it to the frame time
+        else if (std::strcmp(argv[i], "--render-scale") == 0 && i + 1 < argc) {
+            game.setRenderScale(static_cast<float>(std::atof(argv[++i])));
+        }
+        // Draw the game world on the CPU with SIMD kernels instead of through SDL's renderer
+        else if (std::strcmp(argv[i], "--cpu-renderer") == 0) {
+            game.setCpuRenderer(true);
+        }
+        // Time the CPU renderer against SDL's software renderer (optionally over N frames) and exit
+        else if (std::strcmp(argv[i], "--benchmark-renderer") == 0) {
+            benchmarkFrames = RASTER_BENCHMARK_FRAMES;
+            if (i + 1 < argc && std::atoi(argv[i + 1]) > 0) {
+                benchmarkFrames = std::atoi(argv[++i]);
+            }
+        }
+        // Time VecEnv on one thread and on every core (optionally over N batched steps) and exit
+        else if (std::strcmp(argv[i], "--bench-env") == 0) {
+            envBenchmarkSteps = ENV_BENCHMARK_STEPS;
+            if (i + 1 < argc && std::atoi(argv[i + 1]) > 0) {
+                envBenchmarkSteps = std::atoi(argv[++i]);
+            }
+        }
+        // Play a scripted run for N measured frames (default 3000) with no visible window and
+        // fail if it is slower than the baseline file, or draws or allocates more
+        else if (std::strcmp(argv[i], "--perf-gate") == 0) {
+            perfFrames = PERF_FRAMES;
+            if (i + 1 < argc && std::atoi(argv[i + 1]) > 0) {
+                perfFrames = std::atoi(argv[++i]);
+            }
+        }
+        else if (std::strcmp(argv[i], "--perf-baseline") == 0 && i + 1 < argc) {
+            perfBaseline = argv[++i];
+        }
+        // Overwrite the baseline with this run's figures instead of comparing
+        else if (std::strcmp(argv[i], "--perf-update") == 0) {
+            perfUpdate = true;
+        }
+        // Let the autopilot steer instead of the keyboard
+        else if (std::strcmp(argv[i], "--autopilot") == 0) {
+            game.setAutopilot(true);
+        }
+        // Play N autopilot games (default 1000) with no visible window and print how far they got
+        else if (std::strcmp(argv[i], "--soak") == 0) {
+            soakGames = AUTOPILOT_SOAK_GAMES;
+            if (i + 1 < argc && std::atoi(argv[i + 1]) > 0) {
+                soakGames = std::atoi(argv[++i]);
+            }
+        }
+        // Keep menus built once visited instead of freeing them on exit
+        else if (std::strcmp(argv[i], "--keep-menus") == 0) {
+            game.setReleaseIdleMenus(false);
+        }
+        // Quit with an error if a gameplay frame allocates after warm-up (TRACK_ALLOCATIONS builds)
+        else if (std::strcmp(argv[i], "--strict-allocations") == 0) {
+            game.setStrictAllocations(true);
+        }
+        // Memory allowed for unused cached textures before the least recently used are dropped
+        else if (std::strcmp(argv[i], "--texture-budget-mb") == 0 && i + 1 < argc) {
+            size_t megabytes = static_cast<size_t>(std::atoi(argv[++i]));
+            TheTextureManager::Instance()->setMemoryBudget(megabytes * 1024 * 1024);
+        }
+    }
+    
+    if (benchmarkFrames > 0) {
+        return game.benchmarkRenderer(benchmarkFrames) ? 0 : 1;
+    }
+    if (envBenchmarkSteps > 0) {
+        return benchmarkVecEnv(envBenchmarkSteps) ? 0 : 1;
+    }
+    
+    if (headless && replayPath.empty()) {
+        std::cerr << "--headless needs --replay FILE" << std::endl;
+        return 1;
+    }
+    game.setHeadless(headless || perfFrames > 0 || soakGames > 0);
     
     if (!game.init("2D Game", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 
                   SCREEN_WIDTH, SCREEN_HEIGHT, false)) {
@@ -12,7 +143,25 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
-    game.run();
+    if (!replayPath.empty() && !game.startReplay(replayPath, replaySpeed, replayStart)) {
+        return 1;
+    }
+    
+    if (perfFrames > 0) {
+        bool passed = game.runPerfGate(perfFrames, perfBaseline, perfUpdate);
+        return (passed && !game.didAllocationCheckFail()) ? 0 : 1;
+    }
+    
+    if (soakGames > 0) {
+        game.runSoak(soakGames);
+        return game.didAllocationCheckFail() ? 1 : 0;
+    }
+    
+    if (headless) {
+        game.runHeadless();
+    } else {
+        game.run();
+    }
     
-    return 0;
+    return (game.didAllocationCheckFail() || game.didReplayDiverge()) ? 1 : 0;
 }
\ No newline at end of file
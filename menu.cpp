@@ -1,6 +1,8 @@
 #include "menu.h"
+#include "drawstats.h"
 #include "game.h"
 #include "constants.h"
+#include "audio.h"
 #include <iostream>
 
 // Button implementation
@@ -29,6 +31,7 @@ void Button::render(SDL_Renderer* renderer, TTF_Font* font) {
         );
     } else {
         SDL_SetRenderDrawColor(renderer, 100, 100, 100, 200);
+        countDrawCall();
         SDL_RenderFillRect(renderer, &rect);
         
         if (selected) {
@@ -36,6 +39,7 @@ void Button::render(SDL_Renderer* renderer, TTF_Font* font) {
         } else {
             SDL_SetRenderDrawColor(renderer, normalColor.r, normalColor.g, normalColor.b, normalColor.a);
         }
+        countDrawCall();
         SDL_RenderDrawRect(renderer, &rect);
     }
     
@@ -52,6 +56,7 @@ void Button::render(SDL_Renderer* renderer, TTF_Font* font) {
                 textSurface->h
             };
             
+            countDrawCall();
             SDL_RenderCopy(renderer, textTexture, nullptr, &textRect);
             
             SDL_FreeSurface(textSurface);
@@ -112,7 +117,7 @@ Menu::Menu(Game* game, const std::string& menuTitle)
       menuFont(nullptr),
       hasBackground(false),
       title(menuTitle) {
-    menuFont = TTF_OpenFont("assets/arial.ttf", 28);
+    menuFont = TheTextureManager::Instance()->openFont(FONT_PATH, 28);
     if (!menuFont) {
         std::cerr << "Font load error: " << TTF_GetError() << std::endl;
     }
@@ -143,6 +148,7 @@ void Menu::render(SDL_Renderer* renderer) {
         SDL_SetRenderDrawColor(renderer, 0, 0, 0, 200);
         SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
         SDL_Rect bgRect = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+        countDrawCall();
         SDL_RenderFillRect(renderer, &bgRect);
         SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
     }
@@ -160,6 +166,7 @@ void Menu::render(SDL_Renderer* renderer) {
                 titleSurface->h
             };
             
+            countDrawCall();
             SDL_RenderCopy(renderer, titleTexture, nullptr, &titleRect);
             
             SDL_FreeSurface(titleSurface);
@@ -391,6 +398,7 @@ void GameOverMenu::render(SDL_Renderer* renderer) {
                 scoreSurface->h
             };
             
+            countDrawCall();
             SDL_RenderCopy(renderer, scoreTexture, nullptr, &scoreRect);
             
             SDL_FreeSurface(scoreSurface);
@@ -409,6 +417,7 @@ void GameOverMenu::render(SDL_Renderer* renderer) {
                 distSurface->h
             };
             
+            countDrawCall();
             SDL_RenderCopy(renderer, distTexture, nullptr, &distRect);
             
             SDL_FreeSurface(distSurface);
@@ -481,6 +490,7 @@ void OptionsMenu::init() {
 
 void OptionsMenu::toggleMusic() {
     musicEnabled = !musicEnabled;
+    TheAudioMixer::Instance()->setMusicEnabled(musicEnabled);
     buttons[0]->setPosition(buttons[0]->getRect().x, buttons[0]->getRect().y);
     
     std::string buttonText = "Music: ";
@@ -498,6 +508,7 @@ void OptionsMenu::toggleMusic() {
 
 void OptionsMenu::toggleSound() {
     soundEnabled = !soundEnabled;
+    TheAudioMixer::Instance()->setSoundEnabled(soundEnabled);
     
     std::string buttonText = "Sound Effects: ";
     buttonText += (soundEnabled ? "ON" : "OFF");
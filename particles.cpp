@@ -0,0 +1,282 @@
+#include "particles.h"
+#include "drawstats.h"
+#include "texturemanager.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+ParticleEmitter::ParticleEmitter(const std::string& texture, size_t maxParticles, SDL_Color tint,
+                                 float particleSize, float fall)
+    : textureID(texture),
+      color(tint),
+      particleWidth(particleSize),
+      gravity(fall),
+      capacity(maxParticles),
+      count(0),
+      x(maxParticles),
+      y(maxParticles),
+      velocityX(maxParticles),
+      velocityY(maxParticles),
+      life(maxParticles),
+      fade(maxParticles),
+      alpha(maxParticles),
+      vertices(maxParticles * 4),
+      indices(maxParticles * 6),
+      rng(std::random_device()()) {
+    for (size_t i = 0; i < maxParticles; ++i) {
+        int corner = static_cast<int>(i * 4);
+        int* quad = &indices[i * 6];
+        quad[0] = corner;
+        quad[1] = corner + 1;
+        quad[2] = corner + 2;
+        quad[3] = corner + 2;
+        quad[4] = corner + 3;
+        quad[5] = corner;
+    }
+    
+    // Texture coordinates never change
+    for (size_t i = 0; i < maxParticles; ++i) {
+        SDL_Vertex* quad = &vertices[i * 4];
+        quad[0].tex_coord = {0.0f, 0.0f};
+        quad[1].tex_coord = {1.0f, 0.0f};
+        quad[2].tex_coord = {1.0f, 1.0f};
+        quad[3].tex_coord = {0.0f, 1.0f};
+    }
+}
+
+void ParticleEmitter::emit(float centerX, float centerY, int burst, float speed, int lifeTicks) {
+    std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+    std::uniform_real_distribution<float> spread(0.25f, 1.0f);
+    std::uniform_real_distribution<float> lifeSpread(0.5f, 1.0f);
+    
+    for (int i = 0; i < burst && count < capacity; ++i) {
+        float direction = angle(rng);
+        float velocity = speed * spread(rng);
+        float ticks = lifeTicks * lifeSpread(rng);
+        x[count] = centerX;
+        y[count] = centerY;
+        velocityX[count] = std::cos(direction) * velocity;
+        velocityY[count] = std::sin(direction) * velocity;
+        life[count] = ticks;
+        fade[count] = 1.0f / ticks;
+        alpha[count] = 1.0f;
+        ++count;
+    }
+}
+
+void ParticleEmitter::update(float scrollDistance) {
+    // One field per loop with no branches, so each loop vectorizes
+    float* __restrict px = x.data();
+    float* __restrict py = y.data();
+    float* __restrict vx = velocityX.data();
+    float* __restrict vy = velocityY.data();
+    float* __restrict ticks = life.data();
+    float* __restrict inverseLife = fade.data();
+    float* __restrict opacity = alpha.data();
+    size_t n = count;
+    
+    for (size_t i = 0; i < n; ++i) {
+        vy[i] += gravity;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        px[i] += vx[i];
+    }
+    for (size_t i = 0; i < n; ++i) {
+        py[i] += vy[i] + scrollDistance;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        ticks[i] -= 1.0f;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        opacity[i] = ticks[i] * inverseLife[i];
+    }
+    
+    // Compact: move the last live particle into each dead slot
+    for (size_t i = 0; i < n;) {
+        if (ticks[i] > 0.0f) {
+            ++i;
+            continue;
+        }
+        --n;
+        px[i] = px[n];
+        py[i] = py[n];
+        vx[i] = vx[n];
+        vy[i] = vy[n];
+        ticks[i] = ticks[n];
+        inverseLife[i] = inverseLife[n];
+        opacity[i] = opacity[n];
+    }
+    count = n;
+}
+
+void ParticleEmitter::render(SDL_Renderer* renderer) const {
+    if (count == 0) {
+        return;
+    }
+    SDL_Texture* texture = TheTextureManager::Instance()->findTexture(textureID);
+    
+    float half = particleWidth * 0.5f;
+    for (size_t i = 0; i < count; ++i) {
+        SDL_Color tint = color;
+        tint.a = static_cast<Uint8>(color.a * alpha[i]);
+        float left = x[i] - half;
+        float top = y[i] - half;
+        SDL_Vertex* quad = &vertices[i * 4];
+        quad[0].position = {left, top};
+        quad[1].position = {left + particleWidth, top};
+        quad[2].position = {left + particleWidth, top + particleWidth};
+        quad[3].position = {left, top + particleWidth};
+        quad[0].color = tint;
+        quad[1].color = tint;
+        quad[2].color = tint;
+        quad[3].color = tint;
+    }
+    
+    countDrawCall();
+    SDL_RenderGeometry(renderer, texture, vertices.data(), static_cast<int>(count * 4),
+                       indices.data(), static_cast<int>(count * 6));
+}
+
+void ParticleEmitter::clear() {
+    count = 0;
+}
+
+size_t ParticleEmitter::size() const {
+    return count;
+}
+
+bool ParticleSystem::createParticleTexture(const std::string& id, SDL_Renderer* renderer) {
+    const int diameter = 16;
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, diameter, diameter, 32, SDL_PIXELFORMAT_RGBA32);
+    if (surface == nullptr) {
+        std::cerr << "Failed to create particle surface. SDL Error: " << SDL_GetError() << std::endl;
+        return false;
+    }
+    
+    // White dot fading out towards the edge; emitters tint it through vertex colours
+    SDL_LockSurface(surface);
+    float radius = diameter * 0.5f;
+    for (int row = 0; row < diameter; ++row) {
+        Uint32* pixels = reinterpret_cast<Uint32*>(static_cast<Uint8*>(surface->pixels) + row * surface->pitch);
+        for (int col = 0; col < diameter; ++col) {
+            float dx = col + 0.5f - radius;
+            float dy = row + 0.5f - radius;
+            float falloff = 1.0f - std::sqrt(dx * dx + dy * dy) / radius;
+            Uint8 alpha = static_cast<Uint8>(255.0f * (falloff > 0.0f ? falloff : 0.0f));
+            pixels[col] = SDL_MapRGBA(surface->format, 255, 255, 255, alpha);
+        }
+    }
+    SDL_UnlockSurface(surface);
+    
+    return TheTextureManager::Instance()->createTexture(surface, id, renderer);
+}
+
+int ParticleSystem::addEmitter(const std::string& textureID, size_t maxParticles, SDL_Color tint,
+                               float particleSize, float fall) {
+    emitters.push_back(std::make_unique<ParticleEmitter>(textureID, maxParticles, tint, particleSize, fall));
+    return static_cast<int>(emitters.size() - 1);
+}
+
+void ParticleSystem::emit(int emitter, float centerX, float centerY, int burst, float speed, int lifeTicks) {
+    if (emitter >= 0 && emitter < static_cast<int>(emitters.size())) {
+        emitters[emitter]->emit(centerX, centerY, burst, speed, lifeTicks);
+    }
+}
+
+void ParticleSystem::update(float scrollDistance) {
+    for (auto& emitter : emitters) {
+        emitter->update(scrollDistance);
+    }
+}
+
+void ParticleSystem::render(SDL_Renderer* renderer) const {
+    for (const auto& emitter : emitters) {
+        emitter->render(renderer);
+    }
+}
+
+void ParticleSystem::clear() {
+    for (auto& emitter : emitters) {
+        emitter->clear();
+    }
+}
+
+size_t ParticleSystem::size() const {
+    size_t total = 0;
+    for (const auto& emitter : emitters) {
+        total += emitter->size();
+    }
+    return total;
+}
+
+bool benchmarkParticles(int frames) {
+    if (frames <= 0) {
+        return false;
+    }
+    SDL_Surface* canvas = SDL_CreateRGBSurfaceWithFormat(0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+    SDL_Renderer* software = canvas ? SDL_CreateSoftwareRenderer(canvas) : nullptr;
+    const std::string textureID = "benchmark_particle";
+    if (software == nullptr || !ParticleSystem::createParticleTexture(textureID, software)) {
+        std::cerr << "SDL software renderer unavailable: " << SDL_GetError() << std::endl;
+        if (software) {
+            SDL_DestroyRenderer(software);
+        }
+        SDL_FreeSurface(canvas);
+        return false;
+    }
+
+    // Same look as the crash emitter, topped up with crash bursts at pseudo-random points
+    ParticleSystem particles;
+    int emitter = particles.addEmitter(textureID, PARTICLE_BENCHMARK_COUNT, SDL_Color{255, 90, 30, 255}, 10.0f, 0.15f);
+    uint32_t random = 12345;
+    auto next = [&random]() {
+        random = random * 1664525u + 1013904223u;
+        return random >> 8;
+    };
+
+    std::vector<double> frameMs;
+    frameMs.reserve(frames);
+    double updateMs = 0.0;
+    double renderMs = 0.0;
+    double frequency = static_cast<double>(SDL_GetPerformanceFrequency());
+    for (int frame = 0; frame < frames; ++frame) {
+        // Clearing isn't part of the particles' cost; the software renderer queues it until a flush
+        SDL_SetRenderDrawColor(software, 50, 50, 50, 255);
+        SDL_RenderClear(software);
+        SDL_RenderFlush(software);
+
+        Uint64 start = SDL_GetPerformanceCounter();
+        while (particles.size() < static_cast<size_t>(PARTICLE_BENCHMARK_COUNT)) {
+            float x = static_cast<float>(next() % SCREEN_WIDTH);
+            float y = static_cast<float>(next() % SCREEN_HEIGHT);
+            particles.emit(emitter, x, y, CRASH_PARTICLE_BURST, 6.0f, 90);
+        }
+        particles.update();
+        Uint64 updated = SDL_GetPerformanceCounter();
+        particles.render(software);
+        SDL_RenderFlush(software);
+        Uint64 end = SDL_GetPerformanceCounter();
+
+        updateMs += (updated - start) * 1000.0 / frequency;
+        renderMs += (end - updated) * 1000.0 / frequency;
+        frameMs.push_back((end - start) * 1000.0 / frequency);
+    }
+
+    std::sort(frameMs.begin(), frameMs.end());
+    double p95 = frameMs[std::min(frameMs.size() - 1, frameMs.size() * 95 / 100)];
+    std::cout << "Particle benchmark: " << PARTICLE_BENCHMARK_COUNT << " live particles on SDL's software renderer, "
+              << frames << " frames" << std::endl;
+    std::cout << "  update " << updateMs / frames << " ms, render " << renderMs / frames
+              << " ms (vertices and SDL_RenderGeometry), total p50 " << frameMs[frameMs.size() / 2]
+              << " ms, p95 " << p95 << " ms, max " << frameMs.back() << " ms (budget "
+              << PARTICLE_BUDGET_MS << " ms)" << std::endl;
+
+    TheTextureManager::Instance()->clearTextures();
+    SDL_DestroyRenderer(software);
+    SDL_FreeSurface(canvas);
+    bool withinBudget = frameMs[frameMs.size() / 2] <= PARTICLE_BUDGET_MS;
+    if (!withinBudget) {
+        std::cerr << "Particles exceeded the " << PARTICLE_BUDGET_MS << " ms budget" << std::endl;
+    }
+    return withinBudget;
+}
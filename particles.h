@@ -0,0 +1,76 @@
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include <SDL2/SDL.h>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "constants.h"
+
+const int PARTICLE_BENCHMARK_COUNT          = 50000; // Live particles kept up by --benchmark-renderer
+const double PARTICLE_BUDGET_MS             = 2.0;   // Update plus render allowed at that count
+
+// Fixed-capacity burst emitter. Particles are stored as parallel arrays (one per
+// field) so update() runs simple loops over contiguous floats; dead particles are
+// removed by moving the last live one into their slot. Everything is allocated
+// up front, and render() draws every particle of the emitter in one
+// SDL_RenderGeometry call with its texture.
+class ParticleEmitter {
+private:
+    std::string textureID;
+    SDL_Color color;
+    float particleWidth;    // Drawn width and height in pixels
+    float gravity;          // Added to vertical velocity every tick
+    size_t capacity;
+    size_t count;
+
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> velocityX;
+    std::vector<float> velocityY;
+    std::vector<float> life;        // Ticks left
+    std::vector<float> fade;        // 1 / starting life, to turn life into alpha
+    std::vector<float> alpha;
+
+    mutable std::vector<SDL_Vertex> vertices;   // Four per particle
+    std::vector<int> indices;                   // Two triangles per particle, built once
+    std::minstd_rand rng;
+
+public:
+    ParticleEmitter(const std::string& texture, size_t maxParticles, SDL_Color tint, float particleSize, float fall);
+
+    // Spray count particles from (centerX, centerY) in random directions at up to speed
+    // pixels per tick, each living lifeTicks. Particles beyond capacity are dropped.
+    void emit(float centerX, float centerY, int burst, float speed, int lifeTicks);
+    void update(float scrollDistance);
+    void render(SDL_Renderer* renderer) const;
+    void clear();
+    size_t size() const;
+};
+
+// All particle emitters in the game
+class ParticleSystem {
+private:
+    std::vector<std::unique_ptr<ParticleEmitter>> emitters;
+
+public:
+    // Soft round texture the emitters can use, registered with the texture manager under id
+    static bool createParticleTexture(const std::string& id, SDL_Renderer* renderer);
+
+    // Returns the emitter's index for emit()
+    int addEmitter(const std::string& textureID, size_t maxParticles, SDL_Color tint, float particleSize, float fall);
+    void emit(int emitter, float centerX, float centerY, int burst, float speed, int lifeTicks);
+    void update(float scrollDistance = SCROLL_SPEED);
+    void render(SDL_Renderer* renderer) const;
+    void clear();
+    size_t size() const;
+};
+
+// Keep PARTICLE_BENCHMARK_COUNT crash particles alive on SDL's software renderer for frames
+// frames, print update and render times (render includes SDL_RenderGeometry's rasterization)
+// and return false if the budget is exceeded. Call instead of Game::init().
+bool benchmarkParticles(int frames);
+
+#endif // PARTICLES_H
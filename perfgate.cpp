@@ -0,0 +1,171 @@
+#include "perfgate.h"
+#include "replay.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+
+uint8_t getPerfInput(uint32_t frame) {
+    // Integer hash of the hold index (from Chris Wellons' "lowbias32")
+    uint32_t hash = frame / PERF_INPUT_HOLD;
+    hash ^= hash >> 16;
+    hash *= 0x7FEB352Du;
+    hash ^= hash >> 15;
+    hash *= 0x846CA68Bu;
+    hash ^= hash >> 16;
+    switch (hash % 3) {
+        case 1:
+            return INPUT_LEFT;
+        case 2:
+            return INPUT_RIGHT;
+        default:
+            return 0;
+    }
+}
+
+PerfRecorder::PerfRecorder(int frames)
+    : allocations(0),
+      drawCalls(0),
+      allocatingFrames(0),
+      firstAllocatingFrame(-1) {
+    frameMs.reserve(frames > 0 ? frames : 0);
+}
+
+void PerfRecorder::recordFrame(uint32_t frame, double ms, uint64_t frameAllocations, uint64_t frameDrawCalls) {
+    if (frameMs.size() < frameMs.capacity()) {
+        frameMs.push_back(ms);
+        allocations += frameAllocations;
+        drawCalls += frameDrawCalls;
+        if (frameAllocations > 0) {
+            if (allocatingFrames++ == 0) {
+                firstAllocatingFrame = static_cast<int>(frame);
+            }
+            std::cerr << "Perf gate: frame " << frame << " allocated " << frameAllocations << " times" << std::endl;
+        }
+    }
+}
+
+int PerfRecorder::getFrameCount() const {
+    return static_cast<int>(frameMs.size());
+}
+
+PerfMetrics PerfRecorder::getMetrics() const {
+    PerfMetrics metrics = {};
+    metrics.frames = static_cast<int>(frameMs.size());
+    metrics.allocatingFrames = allocatingFrames;
+    metrics.firstAllocatingFrame = firstAllocatingFrame;
+    if (frameMs.empty()) {
+        return metrics;
+    }
+
+    std::vector<double> sorted(frameMs);
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&sorted](double fraction) {
+        // Nearest rank
+        size_t rank = static_cast<size_t>(fraction * sorted.size() + 0.999999);
+        return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+    };
+    metrics.p50Ms = percentile(0.50);
+    metrics.p95Ms = percentile(0.95);
+    metrics.p99Ms = percentile(0.99);
+    metrics.maxMs = sorted.back();
+    metrics.allocationsPerFrame = static_cast<double>(allocations) / metrics.frames;
+    metrics.drawCallsPerFrame = static_cast<double>(drawCalls) / metrics.frames;
+    return metrics;
+}
+
+// Every metric with its name in the baseline file and how far it may grow
+struct PerfField {
+    const char* name;
+    double PerfMetrics::*value;
+    double tolerance;
+    double slack;
+};
+
+static const PerfField perfFields[] = {
+    {"p50_ms", &PerfMetrics::p50Ms, PERF_TIME_TOLERANCE, PERF_TIME_SLACK_MS},
+    {"p95_ms", &PerfMetrics::p95Ms, PERF_TIME_TOLERANCE, PERF_TIME_SLACK_MS},
+    {"p99_ms", &PerfMetrics::p99Ms, PERF_TIME_TOLERANCE, PERF_TIME_SLACK_MS},
+    {"max_ms", &PerfMetrics::maxMs, PERF_MAX_TOLERANCE, PERF_TIME_SLACK_MS},
+    {"allocations_per_frame", &PerfMetrics::allocationsPerFrame, 0.0, 0.0},
+    {"draw_calls_per_frame", &PerfMetrics::drawCallsPerFrame, PERF_DRAW_CALL_TOLERANCE, PERF_DRAW_CALL_SLACK},
+};
+
+void printPerfMetrics(const PerfMetrics& metrics) {
+    std::cout << "Frames measured: " << metrics.frames << std::endl;
+    for (const PerfField& field : perfFields) {
+        std::cout << "  " << std::left << std::setw(24) << field.name << std::right << std::fixed
+                  << std::setprecision(3) << metrics.*field.value << std::endl;
+    }
+    std::cout.unsetf(std::ios::fixed);
+}
+
+bool savePerfBaseline(const std::string& fileName, const PerfMetrics& metrics) {
+    std::ofstream file(fileName);
+    if (!file) {
+        std::cerr << "Failed to write perf baseline: " << fileName << std::endl;
+        return false;
+    }
+    file << "frames " << metrics.frames << "\n";
+    file << std::setprecision(6) << std::fixed;
+    for (const PerfField& field : perfFields) {
+        file << field.name << " " << metrics.*field.value << "\n";
+    }
+    return static_cast<bool>(file);
+}
+
+bool loadPerfBaseline(const std::string& fileName, PerfMetrics& metrics) {
+    std::ifstream file(fileName);
+    if (!file) {
+        return false;
+    }
+    metrics = PerfMetrics{};
+    metrics.firstAllocatingFrame = -1;
+    int found = 0;
+    std::string name;
+    double value;
+    while (file >> name >> value) {
+        if (name == "frames") {
+            metrics.frames = static_cast<int>(value);
+            continue;
+        }
+        for (const PerfField& field : perfFields) {
+            if (name == field.name) {
+                metrics.*field.value = value;
+                ++found;
+            }
+        }
+    }
+    if (found != static_cast<int>(sizeof(perfFields) / sizeof(perfFields[0]))) {
+        std::cerr << "Perf baseline " << fileName << " is missing metrics" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool comparePerfMetrics(const PerfMetrics& baseline, const PerfMetrics& current) {
+    bool passed = true;
+    std::cout << std::left << std::setw(24) << "metric" << std::right << std::setw(12) << "baseline"
+              << std::setw(12) << "current" << std::setw(10) << "change" << std::setw(12) << "limit" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    for (const PerfField& field : perfFields) {
+        double before = baseline.*field.value;
+        double after = current.*field.value;
+        double limit = before * (1.0 + field.tolerance) + field.slack;
+        bool regressed = after > limit;
+        passed = passed && !regressed;
+
+        std::cout << std::left << std::setw(24) << field.name << std::right << std::setw(12) << before
+                  << std::setw(12) << after;
+        if (before > 0.0) {
+            std::cout << std::setw(9) << std::setprecision(1) << (after / before - 1.0) * 100.0 << "%"
+                      << std::setprecision(3);
+        } else {
+            std::cout << std::setw(10) << "-";
+        }
+        std::cout << std::setw(12) << limit << (regressed ? "  REGRESSED" : "") << std::endl;
+    }
+    std::cout.unsetf(std::ios::fixed);
+    std::cout << std::setprecision(6);
+    return passed;
+}
@@ -0,0 +1,64 @@
+#ifndef PERFGATE_H
+#define PERFGATE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+const uint32_t PERF_SEED                    = 20240601;  // Map seed of the first run; each restart adds one
+const int PERF_FRAMES                       = 3000;      // Default length of --perf-gate
+const int PERF_WARMUP_FRAMES                = 120;       // Played before measuring starts
+const char* const PERF_BASELINE_PATH        = "perf_baseline.txt";
+const int PERF_INPUT_HOLD                   = 16;        // Frames each scripted input is held
+const double PERF_TIME_TOLERANCE            = 0.25;      // Frame time percentiles may grow by this fraction...
+const double PERF_MAX_TOLERANCE             = 1.0;       // ...the slowest frame, a single sample, by this much...
+const double PERF_TIME_SLACK_MS             = 0.5;       // ...plus this, so sub-ms timer noise can't fail the gate
+const double PERF_DRAW_CALL_TOLERANCE       = 0.05;      // Draw calls per frame may grow by this fraction...
+const double PERF_DRAW_CALL_SLACK           = 0.5;       // ...plus this many; no measured frame may allocate at all
+
+// Steering for the scripted run: left, right or neither for PERF_INPUT_HOLD frames at a
+// time, picked by a fixed hash of the frame number so every run plays the same inputs
+uint8_t getPerfInput(uint32_t frame);
+
+// Summary of a measured run
+struct PerfMetrics {
+    double p50Ms;
+    double p95Ms;
+    double p99Ms;
+    double maxMs;
+    double allocationsPerFrame;     // 0 unless built with -DTRACK_ALLOCATIONS
+    double drawCallsPerFrame;
+    int frames;
+    int allocatingFrames;           // Measured frames that allocated; not kept in baselines
+    int firstAllocatingFrame;       // Frame number of the first of them, -1 if none
+};
+
+// Collects per-frame figures; recording never allocates
+class PerfRecorder {
+private:
+    std::vector<double> frameMs;
+    uint64_t allocations;
+    uint64_t drawCalls;
+    int allocatingFrames;
+    int firstAllocatingFrame;
+
+public:
+    explicit PerfRecorder(int frames);
+
+    // frame numbers the frame for reports; it is the run's frame count, warm-up included
+    void recordFrame(uint32_t frame, double ms, uint64_t frameAllocations, uint64_t frameDrawCalls);
+    int getFrameCount() const;
+    PerfMetrics getMetrics() const;
+};
+
+void printPerfMetrics(const PerfMetrics& metrics);
+
+// Baselines are "name value" lines, one per metric
+bool savePerfBaseline(const std::string& fileName, const PerfMetrics& metrics);
+bool loadPerfBaseline(const std::string& fileName, PerfMetrics& metrics);
+
+// Print a side-by-side table of baseline and current figures; false if any metric
+// went past its tolerance
+bool comparePerfMetrics(const PerfMetrics& baseline, const PerfMetrics& current);
+
+#endif // PERFGATE_H
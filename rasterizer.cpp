@@ -0,0 +1,576 @@
+#include "rasterizer.h"
+#include "constants.h"
+#include "jobsystem.h"
+#include "drawstats.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define RASTER_X86 1
+#include <immintrin.h>
+// Kernels are compiled for their instruction set one function at a time, so the
+// rest of the game needs no special compiler flags and runs on any x86 CPU
+#define RASTER_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+// Blend count premultiplied source pixels over dst
+typedef void (*BlendRowFunction)(uint32_t* dst, const uint32_t* src, int count);
+
+// dst * (255 - source alpha) / 255 per channel, rounded, plus the source. Two channels
+// are worked on at once in 16-bit lanes; the vector kernels do the same sums so all
+// kernels give identical pixels.
+static inline uint32_t blendPixel(uint32_t src, uint32_t dst) {
+    uint32_t inverse = 255 - (src >> 24);
+    uint32_t redBlue = (dst & 0x00FF00FF) * inverse + 0x00800080;
+    uint32_t alphaGreen = ((dst >> 8) & 0x00FF00FF) * inverse + 0x00800080;
+    redBlue = ((redBlue + ((redBlue >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+    alphaGreen = (alphaGreen + ((alphaGreen >> 8) & 0x00FF00FF)) & 0xFF00FF00;
+    return src + (redBlue | alphaGreen);
+}
+
+static void blendRowScalar(uint32_t* dst, const uint32_t* src, int count) {
+    for (int i = 0; i < count; ++i) {
+        uint32_t alpha = src[i] >> 24;
+        if (alpha == 255) {
+            dst[i] = src[i];
+        } else if (alpha != 0) {
+            dst[i] = blendPixel(src[i], dst[i]);
+        }
+    }
+}
+
+#ifdef RASTER_X86
+RASTER_TARGET("sse2")
+static void blendRowSse2(uint32_t* dst, const uint32_t* src, int count) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alphaBits = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+    const __m128i full = _mm_set1_epi16(255);
+    const __m128i bias = _mm_set1_epi16(128);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i source = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i alpha = _mm_and_si128(source, alphaBits);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, alphaBits)) == 0xFFFF) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), source);
+            continue;
+        }
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, zero)) == 0xFFFF) {
+            continue;
+        }
+        __m128i dest = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+
+        // Spread each pixel's alpha over its four 16-bit channel lanes
+        __m128i alpha16 = _mm_srli_epi32(source, 24);
+        alpha16 = _mm_packs_epi32(alpha16, alpha16);
+        alpha16 = _mm_unpacklo_epi16(alpha16, alpha16);
+        __m128i inverseLow = _mm_sub_epi16(full, _mm_unpacklo_epi32(alpha16, alpha16));
+        __m128i inverseHigh = _mm_sub_epi16(full, _mm_unpackhi_epi32(alpha16, alpha16));
+
+        __m128i low = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(dest, zero), inverseLow), bias);
+        __m128i high = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(dest, zero), inverseHigh), bias);
+        low = _mm_srli_epi16(_mm_add_epi16(low, _mm_srli_epi16(low, 8)), 8);
+        high = _mm_srli_epi16(_mm_add_epi16(high, _mm_srli_epi16(high, 8)), 8);
+        __m128i result = _mm_adds_epu8(source, _mm_packus_epi16(low, high));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), result);
+    }
+    blendRowScalar(dst + i, src + i, count - i);
+}
+
+// The SSE2 kernel eight pixels at a time. Unpacks and packs stay within 128-bit
+// lanes, which keeps the pixels in order.
+RASTER_TARGET("avx2")
+static void blendRowAvx2(uint32_t* dst, const uint32_t* src, int count) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alphaBits = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+    const __m256i full = _mm256_set1_epi16(255);
+    const __m256i bias = _mm256_set1_epi16(128);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i source = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i alpha = _mm256_and_si256(source, alphaBits);
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(alpha, alphaBits)) == -1) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), source);
+            continue;
+        }
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(alpha, zero)) == -1) {
+            continue;
+        }
+        __m256i dest = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+
+        __m256i alpha16 = _mm256_srli_epi32(source, 24);
+        alpha16 = _mm256_packs_epi32(alpha16, alpha16);
+        alpha16 = _mm256_unpacklo_epi16(alpha16, alpha16);
+        __m256i inverseLow = _mm256_sub_epi16(full, _mm256_unpacklo_epi32(alpha16, alpha16));
+        __m256i inverseHigh = _mm256_sub_epi16(full, _mm256_unpackhi_epi32(alpha16, alpha16));
+
+        __m256i low = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(dest, zero), inverseLow), bias);
+        __m256i high = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(dest, zero), inverseHigh), bias);
+        low = _mm256_srli_epi16(_mm256_add_epi16(low, _mm256_srli_epi16(low, 8)), 8);
+        high = _mm256_srli_epi16(_mm256_add_epi16(high, _mm256_srli_epi16(high, 8)), 8);
+        __m256i result = _mm256_adds_epu8(source, _mm256_packus_epi16(low, high));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), result);
+    }
+    // The SSE2 kernel isn't VEX-encoded; clear the upper halves first or every
+    // instruction in it pays for the AVX/SSE transition
+    _mm256_zeroupper();
+    blendRowSse2(dst + i, src + i, count - i);
+}
+#endif
+
+static BlendRowFunction getBlendRow(RasterKernel kernel) {
+#ifdef RASTER_X86
+    switch (kernel) {
+        case RasterKernel::AVX2:
+            return blendRowAvx2;
+        case RasterKernel::SSE2:
+            return blendRowSse2;
+        case RasterKernel::SCALAR:
+            break;
+    }
+#else
+    (void)kernel;
+#endif
+    return blendRowScalar;
+}
+
+bool isRasterKernelSupported(RasterKernel kernel) {
+    switch (kernel) {
+        case RasterKernel::AVX2:
+#ifdef RASTER_X86
+            return __builtin_cpu_supports("avx2");
+#else
+            return false;
+#endif
+        case RasterKernel::SSE2:
+#ifdef RASTER_X86
+            return __builtin_cpu_supports("sse2");
+#else
+            return false;
+#endif
+        case RasterKernel::SCALAR:
+            return true;
+    }
+    return false;
+}
+
+RasterKernel detectRasterKernel() {
+    if (isRasterKernelSupported(RasterKernel::AVX2)) {
+        return RasterKernel::AVX2;
+    }
+    if (isRasterKernelSupported(RasterKernel::SSE2)) {
+        return RasterKernel::SSE2;
+    }
+    return RasterKernel::SCALAR;
+}
+
+const char* getRasterKernelName(RasterKernel kernel) {
+    switch (kernel) {
+        case RasterKernel::AVX2:
+            return "AVX2";
+        case RasterKernel::SSE2:
+            return "SSE2";
+        case RasterKernel::SCALAR:
+            return "scalar";
+    }
+    return "unknown";
+}
+
+bool makeCpuImage(SDL_Surface* surface, CpuImage& image) {
+    SDL_Surface* argb = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+    if (argb == nullptr) {
+        std::cerr << "Failed to convert surface for the CPU renderer. SDL Error: " << SDL_GetError() << std::endl;
+        return false;
+    }
+
+    image.width = argb->w;
+    image.height = argb->h;
+    image.pixels.resize(static_cast<size_t>(argb->w) * argb->h);
+    image.opaque = true;
+
+    SDL_LockSurface(argb);
+    for (int y = 0; y < argb->h; ++y) {
+        const uint32_t* row = reinterpret_cast<const uint32_t*>(static_cast<const uint8_t*>(argb->pixels) + y * argb->pitch);
+        uint32_t* out = &image.pixels[static_cast<size_t>(y) * argb->w];
+        for (int x = 0; x < argb->w; ++x) {
+            uint32_t pixel = row[x];
+            uint32_t alpha = pixel >> 24;
+            if (alpha != 255) {
+                image.opaque = false;
+                // Same rounded multiply as blending, by alpha instead of its inverse
+                uint32_t redBlue = (pixel & 0x00FF00FF) * alpha + 0x00800080;
+                uint32_t green = ((pixel >> 8) & 0xFF) * alpha + 0x80;
+                redBlue = ((redBlue + ((redBlue >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+                green = ((green + (green >> 8)) >> 8) & 0xFF;
+                pixel = (alpha << 24) | redBlue | (green << 8);
+            }
+            out[x] = pixel;
+        }
+    }
+    SDL_UnlockSurface(argb);
+    SDL_FreeSurface(argb);
+    return true;
+}
+
+SoftwareRasterizer::SoftwareRasterizer(int maxFrameWidth, int maxFrameHeight)
+    : maxWidth(std::min(maxFrameWidth, RASTER_MAX_WIDTH)),
+      maxHeight(maxFrameHeight),
+      width(0),
+      height(0),
+      scale(1.0f),
+      clearColor(0xFF000000u),
+      kernel(detectRasterKernel()),
+      parallel(true),
+      streamTexture(nullptr),
+      streamRenderer(nullptr) {
+    commands.reserve(RASTER_COMMAND_RESERVE);
+}
+
+SoftwareRasterizer::~SoftwareRasterizer() {
+    releaseTexture();
+}
+
+void SoftwareRasterizer::setKernel(RasterKernel rasterKernel) {
+    kernel = isRasterKernelSupported(rasterKernel) ? rasterKernel : RasterKernel::SCALAR;
+}
+
+RasterKernel SoftwareRasterizer::getKernel() const {
+    return kernel;
+}
+
+void SoftwareRasterizer::setParallel(bool enabled) {
+    parallel = enabled;
+}
+
+void SoftwareRasterizer::begin(int frameWidth, int frameHeight, float frameScale, uint32_t color) {
+    width = std::max(0, std::min(frameWidth, maxWidth));
+    height = std::max(0, std::min(frameHeight, maxHeight));
+    scale = frameScale;
+    clearColor = color;
+    commands.clear();
+}
+
+void SoftwareRasterizer::draw(const CpuImage& image, const SDL_Rect* srcRect, const SDL_Rect& destRect,
+                              SDL_RendererFlip flip) {
+    SDL_Rect src = srcRect ? *srcRect : SDL_Rect{0, 0, image.width, image.height};
+    if (src.w <= 0 || src.h <= 0 || destRect.w <= 0 || destRect.h <= 0) {
+        return;
+    }
+
+    // Clip the source to the image and shrink the destination in proportion, as SDL does
+    int left = std::max(src.x, 0);
+    int top = std::max(src.y, 0);
+    int right = std::min(src.x + src.w, image.width);
+    int bottom = std::min(src.y + src.h, image.height);
+    if (left >= right || top >= bottom) {
+        return;
+    }
+    int destLeft = destRect.x + (left - src.x) * destRect.w / src.w;
+    int destRight = destRect.x + (right - src.x) * destRect.w / src.w;
+    int destTop = destRect.y + (top - src.y) * destRect.h / src.h;
+    int destBottom = destRect.y + (bottom - src.y) * destRect.h / src.h;
+
+    // Edges are scaled one by one so neighbouring tiles still meet without gaps
+    DrawCommand command;
+    command.image = &image;
+    command.srcRect = SDL_Rect{left, top, right - left, bottom - top};
+    command.x0 = static_cast<int>(std::floor(destLeft * scale));
+    command.x1 = static_cast<int>(std::floor(destRight * scale));
+    command.y0 = static_cast<int>(std::floor(destTop * scale));
+    command.y1 = static_cast<int>(std::floor(destBottom * scale));
+    command.flipX = (flip & SDL_FLIP_HORIZONTAL) != 0;
+    command.flipY = (flip & SDL_FLIP_VERTICAL) != 0;
+    if (command.x0 >= command.x1 || command.y0 >= command.y1 ||
+        command.x1 <= 0 || command.x0 >= width || command.y1 <= 0 || command.y0 >= height) {
+        return;
+    }
+    commands.push_back(command);
+}
+
+void SoftwareRasterizer::forget(const CpuImage* image) {
+    commands.erase(std::remove_if(commands.begin(), commands.end(),
+                                  [image](const DrawCommand& command) { return command.image == image; }),
+                   commands.end());
+}
+
+void SoftwareRasterizer::rasterizeBand(uint32_t* target, int pitch, int bandBegin, int bandEnd) const {
+    uint32_t scratch[RASTER_MAX_WIDTH];     // One scaled or flipped source row
+    BlendRowFunction blendRow = getBlendRow(kernel);
+
+    for (int y = bandBegin; y < bandEnd; ++y) {
+        uint32_t* row = reinterpret_cast<uint32_t*>(reinterpret_cast<uint8_t*>(target) + static_cast<size_t>(y) * pitch);
+        std::fill_n(row, width, clearColor);
+    }
+
+    for (const DrawCommand& command : commands) {
+        int top = std::max(command.y0, bandBegin);
+        int bottom = std::min(command.y1, bandEnd);
+        int left = std::max(command.x0, 0);
+        int right = std::min(command.x1, width);
+        if (top >= bottom || left >= right) {
+            continue;
+        }
+
+        const CpuImage& image = *command.image;
+        const SDL_Rect& src = command.srcRect;
+        int destWidth = command.x1 - command.x0;
+        int destHeight = command.y1 - command.y0;
+        int count = right - left;
+        bool direct = destWidth == src.w && !command.flipX;
+        // Nearest-neighbour source column stepping in 16.16 fixed point
+        uint32_t stepX = static_cast<uint32_t>((static_cast<uint64_t>(src.w) << 16) / destWidth);
+
+        for (int y = top; y < bottom; ++y) {
+            int sourceY = static_cast<int>(static_cast<int64_t>(y - command.y0) * src.h / destHeight);
+            if (command.flipY) {
+                sourceY = src.h - 1 - sourceY;
+            }
+            const uint32_t* sourceRow = &image.pixels[static_cast<size_t>(src.y + sourceY) * image.width + src.x];
+
+            const uint32_t* source;
+            if (direct) {
+                source = sourceRow + (left - command.x0);
+            } else {
+                uint32_t fixedX = static_cast<uint32_t>(left - command.x0) * stepX;
+                for (int i = 0; i < count; ++i, fixedX += stepX) {
+                    int sourceX = static_cast<int>(fixedX >> 16);
+                    scratch[i] = sourceRow[command.flipX ? src.w - 1 - sourceX : sourceX];
+                }
+                source = scratch;
+            }
+
+            uint32_t* dest = reinterpret_cast<uint32_t*>(reinterpret_cast<uint8_t*>(target) + static_cast<size_t>(y) * pitch) + left;
+            if (image.opaque) {
+                std::memcpy(dest, source, count * sizeof(uint32_t));
+            } else {
+                blendRow(dest, source, count);
+            }
+        }
+    }
+}
+
+void SoftwareRasterizer::rasterize(uint32_t* target, int pitch) {
+    int bands = (height + RASTER_BAND_ROWS - 1) / RASTER_BAND_ROWS;
+    auto rasterizeBands = [&](int bandBegin, int bandEnd) {
+        for (int band = bandBegin; band < bandEnd; ++band) {
+            rasterizeBand(target, pitch, band * RASTER_BAND_ROWS, std::min(height, (band + 1) * RASTER_BAND_ROWS));
+        }
+    };
+    if (parallel && !TheJobSystem::Instance()->isSingleThreaded()) {
+        TheJobSystem::Instance()->parallelFor(0, bands, 1, rasterizeBands);
+    } else {
+        rasterizeBands(0, bands);
+    }
+    commands.clear();
+}
+
+bool SoftwareRasterizer::present(SDL_Renderer* renderer, const SDL_Rect& screenRect) {
+    if (width <= 0 || height <= 0) {
+        commands.clear();
+        return false;
+    }
+    if (!streamTexture || streamRenderer != renderer) {
+        releaseTexture();
+        streamTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+                                          maxWidth, maxHeight);
+        if (streamTexture == nullptr) {
+            std::cerr << "Failed to create the CPU renderer's texture. SDL Error: " << SDL_GetError() << std::endl;
+            commands.clear();
+            return false;
+        }
+        streamRenderer = renderer;
+        SDL_SetTextureBlendMode(streamTexture, SDL_BLENDMODE_NONE);
+    }
+
+    // Rasterize straight into the texture's memory; every locked pixel gets written
+    SDL_Rect frame = {0, 0, width, height};
+    void* pixels = nullptr;
+    int pitch = 0;
+    if (SDL_LockTexture(streamTexture, &frame, &pixels, &pitch) != 0) {
+        std::cerr << "Failed to lock the CPU renderer's texture. SDL Error: " << SDL_GetError() << std::endl;
+        commands.clear();
+        return false;
+    }
+    rasterize(static_cast<uint32_t*>(pixels), pitch);
+    SDL_UnlockTexture(streamTexture);
+    countDrawCall();
+    return SDL_RenderCopy(renderer, streamTexture, &frame, &screenRect) == 0;
+}
+
+void SoftwareRasterizer::releaseTexture() {
+    if (streamTexture) {
+        SDL_DestroyTexture(streamTexture);
+        streamTexture = nullptr;
+    }
+    streamRenderer = nullptr;
+}
+
+int SoftwareRasterizer::getWidth() const {
+    return width;
+}
+
+int SoftwareRasterizer::getHeight() const {
+    return height;
+}
+
+size_t SoftwareRasterizer::getCommandCount() const {
+    return commands.size();
+}
+
+// Straight-alpha test sprite: an opaque gradient, or a soft-edged disc
+static SDL_Surface* makeBenchmarkSurface(int w, int h, bool opaque, uint32_t color) {
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (surface == nullptr) {
+        return nullptr;
+    }
+    SDL_LockSurface(surface);
+    float radius = std::min(w, h) * 0.5f;
+    for (int y = 0; y < h; ++y) {
+        uint32_t* row = reinterpret_cast<uint32_t*>(static_cast<uint8_t*>(surface->pixels) + y * surface->pitch);
+        for (int x = 0; x < w; ++x) {
+            uint32_t alpha = 255;
+            if (!opaque) {
+                float dx = x + 0.5f - w * 0.5f;
+                float dy = y + 0.5f - h * 0.5f;
+                float edge = (radius - std::sqrt(dx * dx + dy * dy)) / 6.0f;
+                alpha = static_cast<uint32_t>(std::max(0.0f, std::min(1.0f, edge)) * 255.0f);
+            }
+            uint32_t shade = static_cast<uint32_t>((x * 255 / std::max(1, w - 1) + y * 255 / std::max(1, h - 1)) / 2);
+            row[x] = (alpha << 24) | ((color & 0xFFFFFF) ^ (shade * 0x010101u & 0x3F3F3F));
+        }
+    }
+    SDL_UnlockSurface(surface);
+    return surface;
+}
+
+bool benchmarkRasterizer(int frames) {
+    struct BenchmarkDraw {
+        int image;
+        SDL_Rect destRect;
+    };
+
+    // A busy gameplay screen: background, about half the map cells filled, moving
+    // sprites and the player
+    const int imageCount = 4;
+    SDL_Surface* surfaces[imageCount] = {
+        makeBenchmarkSurface(SCREEN_WIDTH, SCREEN_HEIGHT, true, 0x304060),
+        makeBenchmarkSurface(GRID_SIZE, GRID_SIZE, false, 0xC04020),
+        makeBenchmarkSurface(GRID_SIZE, GRID_SIZE, false, 0xF0D020),
+        makeBenchmarkSurface(PLAYER_WIDTH, PLAYER_HEIGHT, false, 0x20A0F0),
+    };
+    CpuImage images[imageCount];
+    for (int i = 0; i < imageCount; ++i) {
+        if (!surfaces[i] || !makeCpuImage(surfaces[i], images[i])) {
+            std::cerr << "Failed to create benchmark images" << std::endl;
+            for (SDL_Surface* surface : surfaces) {
+                SDL_FreeSurface(surface);
+            }
+            return false;
+        }
+    }
+
+    std::vector<BenchmarkDraw> scene;
+    scene.push_back({0, SDL_Rect{0, 0, SCREEN_WIDTH, SCREEN_HEIGHT}});
+    uint32_t random = 12345;
+    auto next = [&random]() {
+        random = random * 1664525u + 1013904223u;
+        return random >> 8;
+    };
+    for (int row = 0; row < GRID_ROWS; ++row) {
+        for (int col = 0; col < GRID_COLS; ++col) {
+            if (next() % 2 == 0) {
+                scene.push_back({1 + static_cast<int>(next() % 2), SDL_Rect{col * GRID_SIZE, row * GRID_SIZE, GRID_SIZE, GRID_SIZE}});
+            }
+        }
+    }
+    for (int i = 0; i < 200; ++i) {
+        int x = static_cast<int>(next() % SCREEN_WIDTH) - GRID_SIZE / 2;
+        int y = static_cast<int>(next() % SCREEN_HEIGHT) - GRID_SIZE / 2;
+        scene.push_back({1 + static_cast<int>(next() % 2), SDL_Rect{x, y, GRID_SIZE, GRID_SIZE}});
+    }
+    scene.push_back({3, SDL_Rect{SCREEN_WIDTH / 2 - PLAYER_WIDTH / 2, SCREEN_HEIGHT - PLAYER_HEIGHT - 50, PLAYER_WIDTH, PLAYER_HEIGHT}});
+
+    std::cout << "Renderer benchmark: " << SCREEN_WIDTH << "x" << SCREEN_HEIGHT << ", " << scene.size()
+              << " draws, " << frames << " frames" << std::endl;
+    double frequency = static_cast<double>(SDL_GetPerformanceFrequency());
+
+    // SDL's own software renderer drawing the same scene into a surface
+    double sdlMs = 0.0;
+    SDL_Surface* canvas = SDL_CreateRGBSurfaceWithFormat(0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+    SDL_Renderer* software = canvas ? SDL_CreateSoftwareRenderer(canvas) : nullptr;
+    if (software) {
+        SDL_Texture* textures[imageCount] = {};
+        for (int i = 0; i < imageCount; ++i) {
+            textures[i] = SDL_CreateTextureFromSurface(software, surfaces[i]);
+            SDL_SetTextureBlendMode(textures[i], i == 0 ? SDL_BLENDMODE_NONE : SDL_BLENDMODE_BLEND);
+        }
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (int frame = 0; frame < frames; ++frame) {
+            SDL_SetRenderDrawColor(software, 50, 50, 50, 255);
+            SDL_RenderClear(software);
+            for (const BenchmarkDraw& draw : scene) {
+                SDL_RenderCopy(software, textures[draw.image], nullptr, &draw.destRect);
+            }
+            SDL_RenderPresent(software);
+        }
+        sdlMs = (SDL_GetPerformanceCounter() - start) * 1000.0 / frequency / frames;
+        std::cout << "  SDL software renderer: " << sdlMs << " ms/frame" << std::endl;
+        for (SDL_Texture* texture : textures) {
+            if (texture) {
+                SDL_DestroyTexture(texture);
+            }
+        }
+        SDL_DestroyRenderer(software);
+    } else {
+        std::cerr << "SDL software renderer unavailable: " << SDL_GetError() << std::endl;
+    }
+    SDL_FreeSurface(canvas);
+    for (SDL_Surface* surface : surfaces) {
+        SDL_FreeSurface(surface);
+    }
+
+    // Every supported kernel, on one thread and on all workers; each must match the scalar image
+    std::vector<uint32_t> reference(static_cast<size_t>(SCREEN_WIDTH) * SCREEN_HEIGHT);
+    std::vector<uint32_t> framebuffer(reference.size());
+    SoftwareRasterizer rasterizer(SCREEN_WIDTH, SCREEN_HEIGHT);
+    bool matched = true;
+    const RasterKernel kernels[] = {RasterKernel::SCALAR, RasterKernel::SSE2, RasterKernel::AVX2};
+    for (RasterKernel kernel : kernels) {
+        if (!isRasterKernelSupported(kernel)) {
+            continue;
+        }
+        for (int threaded = 0; threaded < 2; ++threaded) {
+            if (threaded && TheJobSystem::Instance()->isSingleThreaded()) {
+                continue;
+            }
+            rasterizer.setKernel(kernel);
+            rasterizer.setParallel(threaded != 0);
+            std::vector<uint32_t>& target = (kernel == RasterKernel::SCALAR && !threaded) ? reference : framebuffer;
+
+            Uint64 start = SDL_GetPerformanceCounter();
+            for (int frame = 0; frame < frames; ++frame) {
+                rasterizer.begin(SCREEN_WIDTH, SCREEN_HEIGHT, 1.0f, 0xFF323232u);
+                for (const BenchmarkDraw& draw : scene) {
+                    rasterizer.draw(images[draw.image], nullptr, draw.destRect);
+                }
+                rasterizer.rasterize(target.data(), SCREEN_WIDTH * static_cast<int>(sizeof(uint32_t)));
+            }
+            double ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / frequency / frames;
+
+            bool same = &target == &reference || target == reference;
+            matched = matched && same;
+            int threads = threaded ? TheJobSystem::Instance()->getWorkerCount() : 1;
+            std::cout << "  " << getRasterKernelName(kernel) << ", " << threads << (threads == 1 ? " thread: " : " threads: ")
+                      << ms << " ms/frame";
+            if (sdlMs > 0.0 && ms > 0.0) {
+                std::cout << " (" << sdlMs / ms << "x SDL)";
+            }
+            std::cout << (same ? "" : " MISMATCH") << std::endl;
+        }
+    }
+    if (!matched) {
+        std::cerr << "Vector kernels differ from the scalar kernel" << std::endl;
+    }
+    return matched;
+}
@@ -0,0 +1,99 @@
+#ifndef RASTERIZER_H
+#define RASTERIZER_H
+
+#include <SDL2/SDL.h>
+#include <cstdint>
+#include <vector>
+
+const int RASTER_BAND_ROWS                  = 32;    // Framebuffer rows per parallel job
+const int RASTER_MAX_WIDTH                  = 4096;  // Widest framebuffer (bounds the per-band row scratch)
+const int RASTER_COMMAND_RESERVE            = 4096;  // Draws per frame before the queue has to grow
+const int RASTER_BENCHMARK_FRAMES           = 200;   // Default length of --benchmark-renderer
+
+// Image for the CPU renderer: ARGB8888 with premultiplied alpha, rows packed
+struct CpuImage {
+    int width;
+    int height;
+    std::vector<uint32_t> pixels;
+    bool opaque;            // Every pixel has full alpha, so drawing it is a plain copy
+};
+
+// Premultiplied copy of any surface; false if the surface can't be converted
+bool makeCpuImage(SDL_Surface* surface, CpuImage& image);
+
+// Row blending code, fastest first
+enum class RasterKernel {
+    AVX2,
+    SSE2,
+    SCALAR
+};
+
+// Fastest kernel this CPU supports
+RasterKernel detectRasterKernel();
+bool isRasterKernelSupported(RasterKernel kernel);
+const char* getRasterKernelName(RasterKernel kernel);
+
+// Software renderer for machines where SDL has no GPU renderer. Draws are queued
+// in game coordinates, scaled by the render scale, then rasterized in horizontal
+// bands on the job system: every band clips every draw to its rows, so bands never
+// touch the same pixels and the result is the same as a serial draw. Opaque images
+// are copied; the rest are blended "source over" with premultiplied alpha.
+class SoftwareRasterizer {
+private:
+    struct DrawCommand {
+        const CpuImage* image;
+        SDL_Rect srcRect;
+        int x0, y0, x1, y1;     // Destination in framebuffer pixels, end exclusive
+        bool flipX;
+        bool flipY;
+    };
+
+    int maxWidth;
+    int maxHeight;
+    int width;              // Size of the current frame, at most maxWidth x maxHeight
+    int height;
+    float scale;
+    uint32_t clearColor;
+    std::vector<DrawCommand> commands;
+    RasterKernel kernel;
+    bool parallel;
+    SDL_Texture* streamTexture;     // Presented frames are rasterized straight into this
+    SDL_Renderer* streamRenderer;
+
+    void rasterizeBand(uint32_t* target, int pitch, int bandBegin, int bandEnd) const;
+
+public:
+    SoftwareRasterizer(int maxFrameWidth, int maxFrameHeight);
+    ~SoftwareRasterizer();
+
+    SoftwareRasterizer(const SoftwareRasterizer&) = delete;
+    SoftwareRasterizer& operator=(const SoftwareRasterizer&) = delete;
+
+    void setKernel(RasterKernel rasterKernel);     // Falls back to scalar if unsupported
+    RasterKernel getKernel() const;
+    void setParallel(bool enabled);                // Spread bands over the job system
+
+    // Start a frame of width x height pixels; draws are given in game coordinates times frameScale
+    void begin(int frameWidth, int frameHeight, float frameScale, uint32_t color);
+    // Same rectangles as SDL_RenderCopyEx; the source is clipped to the image like SDL does
+    void draw(const CpuImage& image, const SDL_Rect* srcRect, const SDL_Rect& destRect,
+              SDL_RendererFlip flip = SDL_FLIP_NONE);
+    // Drop queued draws of an image that is about to be freed
+    void forget(const CpuImage* image);
+
+    // Rasterize the queued draws into target (pitch in bytes) and clear the queue
+    void rasterize(uint32_t* target, int pitch);
+    // Rasterize into a streaming texture and copy it over screenRect of the renderer
+    bool present(SDL_Renderer* renderer, const SDL_Rect& screenRect);
+    void releaseTexture();
+
+    int getWidth() const;
+    int getHeight() const;
+    size_t getCommandCount() const;
+};
+
+// Time a sprite-heavy scene through every supported kernel, single- and multi-threaded,
+// and through SDL's software renderer; prints ms per frame. Needs the job system.
+bool benchmarkRasterizer(int frames);
+
+#endif // RASTERIZER_H
@@ -0,0 +1,253 @@
+#include "replay.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+static const char REPLAY_MAGIC[4] = {'R', 'P', 'L', 'Y'};
+static const uint32_t REPLAY_VERSION = 1;
+
+Replay::Replay()
+    : seed(0),
+      tickCount(0),
+      finalScore(0),
+      finalDistance(0),
+      runInput(0),
+      runLength(0),
+      readOffset(0),
+      readInput(0),
+      readRemaining(0),
+      readTick(0) {
+}
+
+void Replay::begin(uint32_t mapSeed) {
+    seed = mapSeed;
+    tickCount = 0;
+    finalScore = 0;
+    finalDistance = 0;
+    input.clear();
+    keyframes.clear();
+    states.clear();
+    input.reserve(REPLAY_INPUT_RESERVE);
+    keyframes.reserve(REPLAY_KEYFRAME_RESERVE);
+    states.reserve(REPLAY_STATE_RESERVE);
+    runInput = 0;
+    runLength = 0;
+    rewind();
+}
+
+bool Replay::needsKeyframe() const {
+    return tickCount % REPLAY_KEYFRAME_INTERVAL == 0;
+}
+
+std::vector<uint8_t>& Replay::beginKeyframe() {
+    // The current run is written once the input changes, starting where the stream ends now
+    ReplayKeyframe keyframe;
+    keyframe.tick = tickCount;
+    keyframe.inputOffset = static_cast<uint32_t>(input.size());
+    keyframe.runTicks = runLength;
+    keyframe.stateOffset = static_cast<uint32_t>(states.size());
+    keyframe.stateSize = 0;
+    keyframes.push_back(keyframe);
+    return states;
+}
+
+void Replay::endKeyframe() {
+    ReplayKeyframe& keyframe = keyframes.back();
+    keyframe.stateSize = static_cast<uint32_t>(states.size()) - keyframe.stateOffset;
+}
+
+void Replay::recordTick(uint8_t tickInput) {
+    if (runLength > 0 && tickInput != runInput) {
+        flushRun();
+    }
+    runInput = tickInput;
+    ++runLength;
+    ++tickCount;
+}
+
+void Replay::flushRun() {
+    // Length as a little-endian base-128 varint, then the input byte
+    uint32_t length = runLength;
+    while (length >= 0x80) {
+        input.push_back(static_cast<uint8_t>(length | 0x80));
+        length >>= 7;
+    }
+    input.push_back(static_cast<uint8_t>(length));
+    input.push_back(runInput);
+    runLength = 0;
+}
+
+void Replay::finish(int score, int distance) {
+    if (runLength > 0) {
+        flushRun();
+    }
+    finalScore = score;
+    finalDistance = distance;
+}
+
+bool Replay::save(const std::string& fileName) const {
+    std::ofstream out(fileName, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Failed to open replay file for writing: " << fileName << std::endl;
+        return false;
+    }
+
+    uint32_t inputSize = static_cast<uint32_t>(input.size());
+    uint32_t keyframeCount = static_cast<uint32_t>(keyframes.size());
+    uint32_t stateSize = static_cast<uint32_t>(states.size());
+    out.write(REPLAY_MAGIC, sizeof(REPLAY_MAGIC));
+    out.write(reinterpret_cast<const char*>(&REPLAY_VERSION), sizeof(REPLAY_VERSION));
+    out.write(reinterpret_cast<const char*>(&seed), sizeof(seed));
+    out.write(reinterpret_cast<const char*>(&tickCount), sizeof(tickCount));
+    out.write(reinterpret_cast<const char*>(&finalScore), sizeof(finalScore));
+    out.write(reinterpret_cast<const char*>(&finalDistance), sizeof(finalDistance));
+    out.write(reinterpret_cast<const char*>(&inputSize), sizeof(inputSize));
+    out.write(reinterpret_cast<const char*>(input.data()), inputSize);
+    out.write(reinterpret_cast<const char*>(&keyframeCount), sizeof(keyframeCount));
+    out.write(reinterpret_cast<const char*>(keyframes.data()), keyframeCount * sizeof(ReplayKeyframe));
+    out.write(reinterpret_cast<const char*>(&stateSize), sizeof(stateSize));
+    out.write(reinterpret_cast<const char*>(states.data()), stateSize);
+
+    if (!out) {
+        std::cerr << "Failed to write replay file: " << fileName << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool Replay::load(const std::string& fileName) {
+    std::ifstream in(fileName, std::ios::binary);
+    if (!in) {
+        std::cerr << "Failed to open replay file: " << fileName << std::endl;
+        return false;
+    }
+
+    char magic[4];
+    uint32_t version = 0;
+    uint32_t inputSize = 0;
+    uint32_t keyframeCount = 0;
+    uint32_t stateSize = 0;
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(&version), sizeof(version));
+    if (!in || !std::equal(magic, magic + 4, REPLAY_MAGIC) || version != REPLAY_VERSION) {
+        std::cerr << "Not a replay file (or an unsupported version): " << fileName << std::endl;
+        return false;
+    }
+
+    in.read(reinterpret_cast<char*>(&seed), sizeof(seed));
+    in.read(reinterpret_cast<char*>(&tickCount), sizeof(tickCount));
+    in.read(reinterpret_cast<char*>(&finalScore), sizeof(finalScore));
+    in.read(reinterpret_cast<char*>(&finalDistance), sizeof(finalDistance));
+    in.read(reinterpret_cast<char*>(&inputSize), sizeof(inputSize));
+    input.resize(in ? inputSize : 0);
+    in.read(reinterpret_cast<char*>(input.data()), input.size());
+    in.read(reinterpret_cast<char*>(&keyframeCount), sizeof(keyframeCount));
+    keyframes.resize(in ? keyframeCount : 0);
+    in.read(reinterpret_cast<char*>(keyframes.data()), keyframes.size() * sizeof(ReplayKeyframe));
+    in.read(reinterpret_cast<char*>(&stateSize), sizeof(stateSize));
+    states.resize(in ? stateSize : 0);
+    in.read(reinterpret_cast<char*>(states.data()), states.size());
+    if (!in) {
+        std::cerr << "Replay file is truncated: " << fileName << std::endl;
+        return false;
+    }
+
+    for (const ReplayKeyframe& keyframe : keyframes) {
+        if (keyframe.inputOffset > inputSize || keyframe.stateOffset > stateSize ||
+            keyframe.stateSize > stateSize - keyframe.stateOffset) {
+            std::cerr << "Replay file has a bad keyframe: " << fileName << std::endl;
+            return false;
+        }
+    }
+
+    runLength = 0;
+    rewind();
+    return true;
+}
+
+void Replay::rewind() {
+    readOffset = 0;
+    readInput = 0;
+    readRemaining = 0;
+    readTick = 0;
+}
+
+bool Replay::readRun() {
+    uint32_t length = 0;
+    int shift = 0;
+    while (readOffset < input.size() && shift < 32) {
+        uint8_t byte = input[readOffset++];
+        length |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        shift += 7;
+        if (!(byte & 0x80)) {
+            if (readOffset >= input.size() || length == 0) {
+                return false;
+            }
+            readInput = input[readOffset++];
+            readRemaining = length;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Replay::isFinished() const {
+    return readTick >= tickCount;
+}
+
+uint8_t Replay::nextInput() {
+    if (isFinished() || (readRemaining == 0 && !readRun())) {
+        // A damaged stream plays out as no input
+        ++readTick;
+        return 0;
+    }
+    --readRemaining;
+    ++readTick;
+    return readInput;
+}
+
+const ReplayKeyframe* Replay::findKeyframe(uint32_t tick) const {
+    // Keyframes are recorded in tick order
+    auto after = std::upper_bound(keyframes.begin(), keyframes.end(), tick,
+                                  [](uint32_t value, const ReplayKeyframe& keyframe) { return value < keyframe.tick; });
+    return after == keyframes.begin() ? nullptr : &*(after - 1);
+}
+
+const uint8_t* Replay::seekKeyframe(const ReplayKeyframe& keyframe) {
+    readOffset = keyframe.inputOffset;
+    readRemaining = 0;
+    readTick = keyframe.tick;
+    if (keyframe.runTicks > 0) {
+        if (!readRun() || readRemaining < keyframe.runTicks) {
+            readRemaining = 0;
+        } else {
+            readRemaining -= keyframe.runTicks;
+        }
+    }
+    return states.data() + keyframe.stateOffset;
+}
+
+uint32_t Replay::getSeed() const {
+    return seed;
+}
+
+uint32_t Replay::getTickCount() const {
+    return tickCount;
+}
+
+uint32_t Replay::getTick() const {
+    return readTick;
+}
+
+int Replay::getFinalScore() const {
+    return finalScore;
+}
+
+int Replay::getFinalDistance() const {
+    return finalDistance;
+}
+
+size_t Replay::getFileSize() const {
+    return sizeof(REPLAY_MAGIC) + 8 * sizeof(uint32_t) + input.size() +
+           keyframes.size() * sizeof(ReplayKeyframe) + states.size();
+}
@@ -0,0 +1,90 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Input for one game tick
+const uint8_t INPUT_LEFT                    = 1;
+const uint8_t INPUT_RIGHT                   = 2;
+
+const int REPLAY_TICKS_PER_SECOND           = 60;
+const int REPLAY_KEYFRAME_INTERVAL          = 30 * REPLAY_TICKS_PER_SECOND; // Ticks between full-state keyframes
+const size_t REPLAY_INPUT_RESERVE           = 64 * 1024;   // Bytes reserved so recording doesn't allocate
+const size_t REPLAY_STATE_RESERVE           = 512 * 1024;
+const int REPLAY_KEYFRAME_RESERVE           = 256;
+
+// Game state at the start of a tick, plus where that tick sits in the input stream
+struct ReplayKeyframe {
+    uint32_t tick;
+    uint32_t inputOffset;      // Byte offset of the input run containing tick
+    uint32_t runTicks;         // Ticks of that run already played before tick
+    uint32_t stateOffset;      // Into the replay's state bytes
+    uint32_t stateSize;
+};
+
+// A recorded run: the map seed, the input for every tick and periodic keyframes.
+// Input is stored as runs of (tick count varint, input byte), so holding a key
+// costs two bytes however long it is held.
+//
+// File layout (native byte order):
+//   "RPLY", version, seed, tick count, final score, final distance
+//   input byte count, input runs
+//   keyframe count, ReplayKeyframe table
+//   state byte count, keyframe states
+class Replay {
+private:
+    uint32_t seed;
+    uint32_t tickCount;
+    int32_t finalScore;
+    int32_t finalDistance;
+    std::vector<uint8_t> input;
+    std::vector<ReplayKeyframe> keyframes;
+    std::vector<uint8_t> states;
+
+    // Recording: the run being extended, written out when the input changes
+    uint8_t runInput;
+    uint32_t runLength;
+
+    // Playback cursor
+    size_t readOffset;
+    uint8_t readInput;
+    uint32_t readRemaining;
+    uint32_t readTick;
+
+    void flushRun();
+    bool readRun();
+
+public:
+    Replay();
+
+    // Recording
+    void begin(uint32_t mapSeed);
+    bool needsKeyframe() const;            // True when the next tick should start with a keyframe
+    // Start a keyframe for the next tick; append its state to the returned buffer, then call endKeyframe()
+    std::vector<uint8_t>& beginKeyframe();
+    void endKeyframe();
+    void recordTick(uint8_t tickInput);
+    void finish(int score, int distance);
+    bool save(const std::string& fileName) const;
+
+    // Playback
+    bool load(const std::string& fileName);
+    void rewind();                         // Back to tick 0
+    bool isFinished() const;               // Every recorded tick has been played
+    uint8_t nextInput();                   // Input for the next tick, advancing the cursor
+    // Last keyframe at or before tick, or nullptr if there is none
+    const ReplayKeyframe* findKeyframe(uint32_t tick) const;
+    // Move the cursor to a keyframe's tick and return its state
+    const uint8_t* seekKeyframe(const ReplayKeyframe& keyframe);
+
+    uint32_t getSeed() const;
+    uint32_t getTickCount() const;
+    uint32_t getTick() const;              // Next tick to play
+    int getFinalScore() const;
+    int getFinalDistance() const;
+    size_t getFileSize() const;
+};
+
+#endif // REPLAY_H
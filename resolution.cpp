@@ -0,0 +1,62 @@
+#include "resolution.h"
+#include "constants.h"
+#include <algorithm>
+
+ResolutionScaler::ResolutionScaler()
+    : scale(RENDER_SCALE_MAX),
+      automatic(true),
+      windowMs(0.0),
+      windowFrames(0),
+      fastWindows(0),
+      lastAverageMs(0.0) {
+}
+
+void ResolutionScaler::recordFrame(double ms) {
+    windowMs += ms;
+    if (++windowFrames < RENDER_SCALE_WINDOW) {
+        return;
+    }
+    lastAverageMs = windowMs / windowFrames;
+    windowMs = 0.0;
+    windowFrames = 0;
+    if (!automatic) {
+        return;
+    }
+
+    if (lastAverageMs > TARGET_FRAME_MS * RENDER_SCALE_DOWN_AT) {
+        scale = std::max(RENDER_SCALE_MIN, scale - RENDER_SCALE_STEP);
+        fastWindows = 0;
+    } else if (lastAverageMs < TARGET_FRAME_MS * RENDER_SCALE_UP_AT) {
+        if (++fastWindows >= RENDER_SCALE_UP_WINDOWS) {
+            scale = std::min(RENDER_SCALE_MAX, scale + RENDER_SCALE_STEP);
+            fastWindows = 0;
+        }
+    } else {
+        fastWindows = 0;
+    }
+}
+
+void ResolutionScaler::setFixedScale(float fixedScale) {
+    scale = std::min(RENDER_SCALE_MAX, std::max(RENDER_SCALE_MIN, fixedScale));
+    automatic = false;
+}
+
+float ResolutionScaler::getScale() const {
+    return scale;
+}
+
+bool ResolutionScaler::isAutomatic() const {
+    return automatic;
+}
+
+double ResolutionScaler::getAverageFrameMs() const {
+    return lastAverageMs;
+}
+
+int ResolutionScaler::getWidth() const {
+    return static_cast<int>(SCREEN_WIDTH * scale + 0.5f);
+}
+
+int ResolutionScaler::getHeight() const {
+    return static_cast<int>(SCREEN_HEIGHT * scale + 0.5f);
+}
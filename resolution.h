@@ -0,0 +1,41 @@
+#ifndef RESOLUTION_H
+#define RESOLUTION_H
+
+const double TARGET_FRAME_MS                = 1000.0 / 60.0;
+const float RENDER_SCALE_MIN                = 0.5f;
+const float RENDER_SCALE_MAX                = 1.0f;
+const float RENDER_SCALE_STEP               = 0.125f;
+const int RENDER_SCALE_WINDOW               = 30;    // Frames averaged per decision
+const double RENDER_SCALE_DOWN_AT           = 0.9;   // Of the target frame time: lower the scale above this
+const double RENDER_SCALE_UP_AT             = 0.6;   // Raise it below this
+const int RENDER_SCALE_UP_WINDOWS           = 3;     // Fast windows in a row needed to raise it
+
+// Picks the scale the game world is rendered at from measured frame times.
+// A slow window lowers the scale at once; raising it takes several fast windows
+// in a row, and the gap between the two thresholds keeps it from oscillating.
+class ResolutionScaler {
+private:
+    float scale;
+    bool automatic;
+    double windowMs;       // Frame time summed over the current window
+    int windowFrames;
+    int fastWindows;       // Consecutive windows under the raise threshold
+    double lastAverageMs;  // Average frame time of the last complete window
+
+public:
+    ResolutionScaler();
+
+    // Frame work time in ms, excluding any wait for the frame cap
+    void recordFrame(double ms);
+    // Pin the scale (clamped to the allowed range) and stop adjusting it
+    void setFixedScale(float fixedScale);
+
+    float getScale() const;
+    bool isAutomatic() const;
+    double getAverageFrameMs() const;
+    // Size of the world image at the current scale
+    int getWidth() const;
+    int getHeight() const;
+};
+
+#endif // RESOLUTION_H
@@ -0,0 +1,66 @@
+#ifndef SERIALIZE_H
+#define SERIALIZE_H
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+// Appends plain values to a byte buffer in native byte order. Reserving the
+// buffer once keeps repeated saves from allocating.
+class StateWriter {
+private:
+    std::vector<uint8_t>& buffer;
+
+public:
+    explicit StateWriter(std::vector<uint8_t>& out) : buffer(out) {}
+
+    void writeBytes(const void* data, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        buffer.insert(buffer.end(), bytes, bytes + size);
+    }
+
+    template <typename T>
+    void write(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be written");
+        writeBytes(&value, sizeof(T));
+    }
+
+    size_t size() const { return buffer.size(); }
+};
+
+// Reads values written by StateWriter. Reading past the end fails and leaves
+// the reader failed, so callers can check ok() once at the end.
+class StateReader {
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t offset;
+    bool failed;
+
+public:
+    StateReader(const uint8_t* bytes, size_t length) : data(bytes), size(length), offset(0), failed(false) {}
+
+    bool readBytes(void* out, size_t length) {
+        if (failed || length > size - offset) {
+            failed = true;
+            return false;
+        }
+        std::memcpy(out, data + offset, length);
+        offset += length;
+        return true;
+    }
+
+    template <typename T>
+    bool read(T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be read");
+        return readBytes(&value, sizeof(T));
+    }
+
+    // Mark the data as invalid, e.g. when a value is out of range
+    void fail() { failed = true; }
+    bool ok() const { return !failed; }
+    size_t remaining() const { return size - offset; }
+};
+
+#endif // SERIALIZE_H
@@ -0,0 +1,99 @@
+#include "snapshot.h"
+
+SnapshotStats::SnapshotStats()
+    : saves(0),
+      restores(0),
+      saveUs(0.0),
+      restoreUs(0.0),
+      maxSaveUs(0.0),
+      maxRestoreUs(0.0),
+      maxBytes(0) {
+}
+
+void SnapshotStats::recordSave(double us, size_t bytes) {
+    ++saves;
+    saveUs += us;
+    if (us > maxSaveUs) {
+        maxSaveUs = us;
+    }
+    if (bytes > maxBytes) {
+        maxBytes = bytes;
+    }
+}
+
+void SnapshotStats::recordRestore(double us) {
+    ++restores;
+    restoreUs += us;
+    if (us > maxRestoreUs) {
+        maxRestoreUs = us;
+    }
+}
+
+uint64_t SnapshotStats::getSaves() const {
+    return saves;
+}
+
+uint64_t SnapshotStats::getRestores() const {
+    return restores;
+}
+
+double SnapshotStats::getAverageSave() const {
+    return saves > 0 ? saveUs / saves : 0.0;
+}
+
+double SnapshotStats::getAverageRestore() const {
+    return restores > 0 ? restoreUs / restores : 0.0;
+}
+
+double SnapshotStats::getMaxSave() const {
+    return maxSaveUs;
+}
+
+double SnapshotStats::getMaxRestore() const {
+    return maxRestoreUs;
+}
+
+size_t SnapshotStats::getMaxBytes() const {
+    return maxBytes;
+}
+
+SnapshotRing::SnapshotRing(int slotCount, size_t reserve) : slots(slotCount), head(0), count(0) {
+    for (std::vector<uint8_t>& slot : slots) {
+        slot.reserve(reserve);
+    }
+}
+
+std::vector<uint8_t>& SnapshotRing::push() {
+    std::vector<uint8_t>& slot = slots[head];
+    slot.clear();
+    head = (head + 1) % static_cast<int>(slots.size());
+    if (count < static_cast<int>(slots.size())) {
+        ++count;
+    }
+    return slot;
+}
+
+const std::vector<uint8_t>* SnapshotRing::newest() const {
+    if (count == 0) {
+        return nullptr;
+    }
+    int slot = head > 0 ? head - 1 : static_cast<int>(slots.size()) - 1;
+    return &slots[slot];
+}
+
+void SnapshotRing::pop() {
+    if (count == 0) {
+        return;
+    }
+    head = head > 0 ? head - 1 : static_cast<int>(slots.size()) - 1;
+    --count;
+}
+
+void SnapshotRing::clear() {
+    head = 0;
+    count = 0;
+}
+
+int SnapshotRing::size() const {
+    return count;
+}
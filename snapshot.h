@@ -0,0 +1,56 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+const int REWIND_INTERVAL                   = 4;    // Ticks between rewind snapshots
+const int REWIND_SLOTS                      = 150;  // 10 seconds of play at 60 ticks per second
+const size_t SNAPSHOT_RESERVE               = 32 * 1024; // Bytes reserved per snapshot so taking one doesn't allocate
+
+// How long taking and restoring snapshots took, in microseconds
+class SnapshotStats {
+private:
+    uint64_t saves;
+    uint64_t restores;
+    double saveUs;
+    double restoreUs;
+    double maxSaveUs;
+    double maxRestoreUs;
+    size_t maxBytes;
+
+public:
+    SnapshotStats();
+
+    void recordSave(double us, size_t bytes);
+    void recordRestore(double us);
+
+    uint64_t getSaves() const;
+    uint64_t getRestores() const;
+    double getAverageSave() const;
+    double getAverageRestore() const;
+    double getMaxSave() const;
+    double getMaxRestore() const;
+    size_t getMaxBytes() const;
+};
+
+// The most recent snapshots, newest last; when full, pushing overwrites the oldest.
+// Every slot's buffer is reserved up front.
+class SnapshotRing {
+private:
+    std::vector<std::vector<uint8_t>> slots;
+    int head;      // Slot the next push writes
+    int count;
+
+public:
+    SnapshotRing(int slotCount, size_t reserve);
+
+    std::vector<uint8_t>& push();                  // Empty buffer for a new newest snapshot
+    const std::vector<uint8_t>* newest() const;    // nullptr if empty
+    void pop();                                    // Drop the newest snapshot
+    void clear();
+    int size() const;
+};
+
+#endif // SNAPSHOT_H
@@ -1,4 +1,9 @@
 #include "texturemanager.h"
+#include "drawstats.h"
+#include "constants.h"
+#include "jobsystem.h"
+#include <algorithm>
+#include <mutex>
 
 // Initialize static instance to nullptr
 TextureManager* TextureManager::instance = nullptr;
@@ -25,18 +30,371 @@ bool TextureManager::init() {
     return true;
 }
 
-bool TextureManager::loadTexture(const std::string& fileName, const std::string& id, SDL_Renderer* renderer) {
+bool TextureManager::openPack(const std::string& fileName) {
+    return pack.open(fileName);
+}
+
+TTF_Font* TextureManager::openFont(const std::string& fileName, int pointSize) {
+    const PackEntry* entry = pack.find(fileName);
+    if (entry && entry->type == PackEntryType::FILE) {
+        // The pack stays mapped until clean(), so the font can read from it directly
+        SDL_RWops* rw = SDL_RWFromConstMem(pack.getData(*entry), static_cast<int>(entry->size));
+        return TTF_OpenFontRW(rw, 1, pointSize);
+    }
+    return TTF_OpenFont(fileName.c_str(), pointSize);
+}
+
+bool TextureManager::createTextureFromPack(const PackEntry& entry, const std::string& id, SDL_Renderer* renderer,
+                                           int frameWidth, int frameHeight) {
+    void* pixels = const_cast<void*>(pack.getData(entry));
+    
+    // Sheet layout recorded in the pack wins over the caller's guess
+    if (entry.frameWidth > 0 && entry.frameHeight > 0) {
+        frameWidth = entry.frameWidth;
+        frameHeight = entry.frameHeight;
+    }
+    if (frameWidth > 0 && frameHeight > 0) {
+        // Wraps the mapped pixels without copying them
+        SDL_Surface* view = SDL_CreateRGBSurfaceWithFormatFrom(pixels, entry.width, entry.height, 32,
+                                                              entry.pitch, entry.pixelFormat);
+        if (view) {
+            buildCollisionMasks(view, id, frameWidth, frameHeight);
+            SDL_FreeSurface(view);
+        }
+    }
+    
+    SDL_Texture* texture = SDL_CreateTexture(renderer, entry.pixelFormat, SDL_TEXTUREACCESS_STATIC,
+                                             entry.width, entry.height);
+    if (texture == nullptr || SDL_UpdateTexture(texture, nullptr, pixels, entry.pitch) != 0) {
+        std::cerr << "Failed to create texture from asset pack. SDL Error: " 
+                  << SDL_GetError() << std::endl;
+        if (texture) {
+            SDL_DestroyTexture(texture);
+        }
+        return false;
+    }
+    SDL_SetTextureBlendMode(texture, (entry.flags & PACK_ENTRY_HAS_ALPHA) ? SDL_BLENDMODE_BLEND : SDL_BLENDMODE_NONE);
+    
+    if (keepCpuImages) {
+        SDL_Surface* view = SDL_CreateRGBSurfaceWithFormatFrom(pixels, entry.width, entry.height, 32,
+                                                              entry.pitch, entry.pixelFormat);
+        if (view) {
+            keepCpuImage(texture, view);
+            SDL_FreeSurface(view);
+        }
+    }
+    trackResident(id, texture);
+    return true;
+}
+
+void TextureManager::registerTexture(const TextureRequest& request) {
+    TextureRecord& record = records[request.id];
+    record.fileName = request.fileName;
+    record.frameWidth = request.frameWidth;
+    record.frameHeight = request.frameHeight;
+}
+
+bool TextureManager::acquire(const std::string& id, SDL_Renderer* renderer) {
+    auto it = records.find(id);
+    if (it == records.end()) {
+        std::cerr << "Texture with ID: " << id << " not registered!" << std::endl;
+        return false;
+    }
+    
+    // Pin before loading so the load itself can't evict it
+    ++it->second.refCount;
+    return useTexture(id, renderer) != nullptr;
+}
+
+void TextureManager::release(const std::string& id) {
+    auto it = records.find(id);
+    if (it == records.end() || it->second.refCount == 0) {
+        return;
+    }
+    
+    // Stays cached until the budget needs the space
+    --it->second.refCount;
+    enforceBudget("");
+}
+
+SDL_Texture* TextureManager::useTexture(const std::string& id, SDL_Renderer* renderer) {
+    auto it = textureMap.find(id);
+    SDL_Texture* texture = (it != textureMap.end()) ? it->second : nullptr;
+    
+    auto record = records.find(id);
+    if (record == records.end()) {
+        return texture;
+    }
+    
+    if (texture == nullptr && !record->second.fileName.empty()) {
+        // First use since registration or eviction
+        if (loadTexture(record->second.fileName, id, renderer, record->second.frameWidth, record->second.frameHeight)) {
+            texture = textureMap[id];
+        }
+    }
+    record->second.lastUsed = ++useClock;
+    return texture;
+}
+
+void TextureManager::trackResident(const std::string& id, SDL_Texture* texture) {
+    auto existing = textureMap.find(id);
+    if (existing != textureMap.end() && existing->second != texture) {
+        evict(id);
+    }
+    textureMap[id] = texture;
+    
+    Uint32 format = 0;
+    int width = 0;
+    int height = 0;
+    SDL_QueryTexture(texture, &format, nullptr, &width, &height);
+    
+    TextureRecord& record = records[id];
+    record.bytes = static_cast<size_t>(width) * height * SDL_BYTESPERPIXEL(format);
+    record.lastUsed = ++useClock;
+    residentBytes += record.bytes;
+    
+    enforceBudget(id);
+}
+
+void TextureManager::evict(const std::string& id) {
+    auto it = textureMap.find(id);
+    if (it == textureMap.end()) {
+        return;
+    }
+    if (it->second != nullptr) {
+        auto image = cpuImages.find(it->second);
+        if (image != cpuImages.end()) {
+            if (rasterizer) {
+                rasterizer->forget(&image->second);
+            }
+            cpuImages.erase(image);
+        }
+        SDL_DestroyTexture(it->second);
+    }
+    textureMap.erase(it);
+    
+    // Collision masks are small and stay, so gameplay never waits on them
+    TextureRecord& record = records[id];
+    residentBytes -= record.bytes;
+    record.bytes = 0;
+}
+
+void TextureManager::enforceBudget(const std::string& keepId) {
+    while (residentBytes > memoryBudget) {
+        // Least recently used texture nobody holds
+        const std::string* victim = nullptr;
+        uint64_t oldest = UINT64_MAX;
+        for (const auto& entry : records) {
+            const TextureRecord& record = entry.second;
+            if (record.bytes > 0 && record.refCount == 0 && entry.first != keepId &&
+                !record.fileName.empty() && record.lastUsed < oldest) {
+                oldest = record.lastUsed;
+                victim = &entry.first;
+            }
+        }
+        if (victim == nullptr) {
+            return; // Everything left is in use
+        }
+        evict(*victim);
+    }
+}
+
+void TextureManager::setMemoryBudget(size_t bytes) {
+    memoryBudget = bytes;
+    enforceBudget("");
+}
+
+size_t TextureManager::getMemoryBudget() const {
+    return memoryBudget;
+}
+
+size_t TextureManager::getTextureBytes(const std::string& id) const {
+    auto it = records.find(id);
+    return it != records.end() ? it->second.bytes : 0;
+}
+
+size_t TextureManager::getResidentBytes() const {
+    return residentBytes;
+}
+
+std::vector<TextureResidency> TextureManager::getResidency() const {
+    std::vector<TextureResidency> report;
+    for (const auto& entry : records) {
+        report.push_back({entry.first, entry.second.bytes, entry.second.refCount, entry.second.bytes > 0});
+    }
+    return report;
+}
+
+bool TextureManager::loadTexture(const std::string& fileName, const std::string& id, SDL_Renderer* renderer,
+                                 int frameWidth, int frameHeight) {
+    registerTexture(TextureRequest{fileName, id, frameWidth, frameHeight});
+    
+    const PackEntry* entry = pack.find(fileName);
+    if (entry && entry->type == PackEntryType::IMAGE) {
+        return createTextureFromPack(*entry, id, renderer, frameWidth, frameHeight);
+    }
+    
+    SDL_Surface* surface = decodeImage(fileName);
+    if (surface == nullptr) {
+        return false;
+    }
+    return createTexture(surface, id, renderer, frameWidth, frameHeight);
+}
+
+// Shared between the decode jobs and the render thread during loadTextures()
+struct AsyncTextureLoad {
+    const std::vector<TextureRequest>* requests;
+    std::vector<SDL_Surface*> surfaces;
+    std::vector<double> decodeMs;
+    std::mutex readyLock;
+    std::vector<int> ready;     // Indices decoded but not yet uploaded
+};
+
+static double elapsedMs(Uint64 start) {
+    return (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+static void decodeTextureJob(void* data, int begin, int end) {
+    AsyncTextureLoad* load = static_cast<AsyncTextureLoad*>(data);
+    for (int i = begin; i < end; ++i) {
+        Uint64 start = SDL_GetPerformanceCounter();
+        load->surfaces[i] = TheTextureManager::Instance()->decodeImage((*load->requests)[i].fileName);
+        load->decodeMs[i] = elapsedMs(start);
+        
+        std::lock_guard<std::mutex> lock(load->readyLock);
+        load->ready.push_back(i);
+    }
+}
+
+bool TextureManager::loadTextures(const std::vector<TextureRequest>& requests, SDL_Renderer* renderer,
+                                  const LoadProgressCallback& onProgress) {
+    Uint64 loadStart = SDL_GetPerformanceCounter();
+    int total = static_cast<int>(requests.size());
+    
+    AsyncTextureLoad load;
+    load.requests = &requests;
+    load.surfaces.assign(total, nullptr);
+    load.decodeMs.assign(total, 0.0);
+    load.ready.reserve(total);
+    
+    loadTimings.assign(total, TextureLoadTiming{"", 0.0, 0.0});
+    for (const TextureRequest& request : requests) {
+        registerTexture(request);
+    }
+    
+    bool success = true;
+    int handled = 0;
+    
+    // Images already in the pack need no decoding; everything else gets one decode job
+    // per image so the large backgrounds don't hold up the sprites
+    std::vector<JobHandle> jobs;
+    jobs.reserve(total);
+    for (int i = 0; i < total; ++i) {
+        const TextureRequest& request = requests[i];
+        const PackEntry* entry = pack.find(request.fileName);
+        if (!entry || entry->type != PackEntryType::IMAGE) {
+            jobs.push_back(TheJobSystem::Instance()->submit(decodeTextureJob, &load, i, i + 1));
+            continue;
+        }
+        
+        Uint64 uploadStart = SDL_GetPerformanceCounter();
+        if (!createTextureFromPack(*entry, request.id, renderer, request.frameWidth, request.frameHeight)) {
+            success = false;
+        }
+        loadTimings[i] = TextureLoadTiming{request.id, 0.0, elapsedMs(uploadStart)};
+        
+        ++handled;
+        if (onProgress) {
+            onProgress(handled, total);
+        }
+    }
+    
+    // Upload decoded images in completion order on this (render) thread
+    std::vector<int> batch;
+    batch.reserve(total);
+    while (handled < total) {
+        batch.clear();
+        {
+            std::lock_guard<std::mutex> lock(load.readyLock);
+            batch.swap(load.ready);
+        }
+        
+        if (batch.empty()) {
+            // Single-threaded: decode here. Otherwise leave the workers to it and stay responsive.
+            if (!TheJobSystem::Instance()->isSingleThreaded() || !TheJobSystem::Instance()->runOneJob()) {
+                SDL_Delay(1);
+            }
+            continue;
+        }
+        
+        for (int i : batch) {
+            const TextureRequest& request = requests[i];
+            TextureLoadTiming& timing = loadTimings[i];
+            timing.id = request.id;
+            timing.decodeMs = load.decodeMs[i];
+            
+            if (load.surfaces[i] == nullptr) {
+                success = false;
+            } else {
+                Uint64 uploadStart = SDL_GetPerformanceCounter();
+                if (!createTexture(load.surfaces[i], request.id, renderer, request.frameWidth, request.frameHeight)) {
+                    success = false;
+                }
+                timing.uploadMs = elapsedMs(uploadStart);
+            }
+            
+            ++handled;
+            if (onProgress) {
+                onProgress(handled, total);
+            }
+        }
+    }
+    
+    for (const JobHandle& job : jobs) {
+        TheJobSystem::Instance()->wait(job);
+    }
+    
+    lastLoadTotalMs = elapsedMs(loadStart);
+    for (const TextureLoadTiming& timing : loadTimings) {
+        std::cout << "Texture " << timing.id << ": decode " << timing.decodeMs 
+                  << " ms, upload " << timing.uploadMs << " ms" << std::endl;
+    }
+    std::cout << "Loaded " << total << " textures in " << lastLoadTotalMs << " ms" << std::endl;
+    
+    return success;
+}
+
+const std::vector<TextureLoadTiming>& TextureManager::getLoadTimings() const {
+    return loadTimings;
+}
+
+double TextureManager::getLastLoadTotalMs() const {
+    return lastLoadTotalMs;
+}
+
+SDL_Surface* TextureManager::decodeImage(const std::string& fileName) const {
     // Load image from file
-    SDL_Surface* tempSurface = IMG_Load(fileName.c_str());
-    if (tempSurface == nullptr) {
+    SDL_Surface* surface = IMG_Load(fileName.c_str());
+    if (surface == nullptr) {
         std::cerr << "Failed to load texture file: " << fileName 
                   << " Error: " << IMG_GetError() << std::endl;
-        return false;
+    }
+    return surface;
+}
+
+bool TextureManager::createTexture(SDL_Surface* surface, const std::string& id, SDL_Renderer* renderer,
+                                   int frameWidth, int frameHeight) {
+    // Masks are read from the decoded pixels before the surface is released
+    if (frameWidth > 0 && frameHeight > 0) {
+        buildCollisionMasks(surface, id, frameWidth, frameHeight);
     }
     
     // Create texture from surface
-    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, tempSurface);
-    SDL_FreeSurface(tempSurface);
+    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+    if (texture != nullptr && keepCpuImages) {
+        keepCpuImage(texture, surface);
+    }
+    SDL_FreeSurface(surface);
     
     if (texture == nullptr) {
         std::cerr << "Failed to create texture from surface. SDL Error: " 
@@ -45,10 +403,133 @@ bool TextureManager::loadTexture(const std::string& fileName, const std::string&
     }
     
     // Add texture to the map
-    textureMap[id] = texture;
+    trackResident(id, texture);
     return true;
 }
 
+void TextureManager::keepCpuImage(SDL_Texture* texture, SDL_Surface* surface) {
+    CpuImage& image = cpuImages[texture];
+    if (!makeCpuImage(surface, image)) {
+        // Still drawable, just through SDL
+        std::cerr << "No CPU copy of texture: " << SDL_GetError() << std::endl;
+        cpuImages.erase(texture);
+    }
+}
+
+void TextureManager::setKeepCpuImages(bool keep) {
+    keepCpuImages = keep;
+}
+
+void TextureManager::setRasterizer(SoftwareRasterizer* target) {
+    rasterizer = target;
+}
+
+void TextureManager::copyTexture(SDL_Renderer* renderer, SDL_Texture* texture, const SDL_Rect* srcRect,
+                                 const SDL_Rect& destRect, SDL_RendererFlip flip) {
+    if (rasterizer && texture) {
+        auto image = cpuImages.find(texture);
+        if (image != cpuImages.end()) {
+            countDrawCall();
+            rasterizer->draw(image->second, srcRect, destRect, flip);
+            return;
+        }
+    }
+    countDrawCall();
+    SDL_RenderCopyEx(renderer, texture, srcRect, &destRect, 0, nullptr, flip);
+}
+
+void TextureManager::buildCollisionMasks(SDL_Surface* surface, const std::string& id, 
+                                         int frameWidth, int frameHeight) {
+    if (frameWidth > 64) {
+        std::cerr << "Collision mask frames wider than 64 pixels are not supported: " << id << std::endl;
+        return;
+    }
+    
+    // Normalize to a 32-bit format so alpha can be read uniformly
+    SDL_Surface* rgba = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA32, 0);
+    if (rgba == nullptr) {
+        std::cerr << "Failed to convert surface for collision masks. SDL Error: " 
+                  << SDL_GetError() << std::endl;
+        return;
+    }
+    
+    SpriteMasks masks;
+    masks.framesPerRow = (rgba->w + frameWidth - 1) / frameWidth;
+    int frameRows = (rgba->h + frameHeight - 1) / frameHeight;
+    masks.frames.resize(masks.framesPerRow * frameRows);
+    
+    SDL_LockSurface(rgba);
+    for (int frameRow = 0; frameRow < frameRows; ++frameRow) {
+        for (int frame = 0; frame < masks.framesPerRow; ++frame) {
+            CollisionMask& mask = masks.frames[frameRow * masks.framesPerRow + frame];
+            mask.width = frameWidth;
+            mask.height = frameHeight;
+            mask.rows.assign(frameHeight, 0);
+            
+            // Pixels outside the sheet stay empty, matching how SDL clips the source rect
+            for (int y = 0; y < frameHeight && frameRow * frameHeight + y < rgba->h; ++y) {
+                const Uint32* pixels = reinterpret_cast<const Uint32*>(
+                    static_cast<const Uint8*>(rgba->pixels) + (frameRow * frameHeight + y) * rgba->pitch);
+                for (int x = 0; x < frameWidth && frame * frameWidth + x < rgba->w; ++x) {
+                    Uint8 r, g, b, a;
+                    SDL_GetRGBA(pixels[frame * frameWidth + x], rgba->format, &r, &g, &b, &a);
+                    if (a >= COLLISION_ALPHA_THRESHOLD) {
+                        mask.rows[y] |= uint64_t(1) << x;
+                    }
+                }
+            }
+        }
+    }
+    SDL_UnlockSurface(rgba);
+    SDL_FreeSurface(rgba);
+    
+    maskMap[id] = std::move(masks);
+}
+
+const CollisionMask* TextureManager::getCollisionMask(const std::string& id, int currentRow, int currentFrame) const {
+    auto it = maskMap.find(id);
+    if (it == maskMap.end()) {
+        return nullptr;
+    }
+    
+    size_t index = currentRow * it->second.framesPerRow + currentFrame;
+    if (currentFrame < 0 || currentFrame >= it->second.framesPerRow || index >= it->second.frames.size()) {
+        return nullptr;
+    }
+    return &it->second.frames[index];
+}
+
+bool masksOverlap(const CollisionMask& a, int ax, int ay,
+                  const CollisionMask& b, int bx, int by, int sweepY) {
+    // Horizontal distance from a's origin to b's origin; beyond a word there is no overlap
+    int dx = bx - ax;
+    if (dx >= 64 || dx <= -64) {
+        return false;
+    }
+    
+    // Scanlines of b that a can reach anywhere along its sweep
+    int top = std::max(ay, by);
+    int bottom = std::min(ay + sweepY + a.height, by + b.height);
+    
+    for (int y = top; y < bottom; ++y) {
+        // OR together every row of a that lands on this scanline during the sweep
+        int firstRow = std::max(0, y - ay - sweepY);
+        int lastRow = std::min(a.height - 1, y - ay);
+        uint64_t swept = 0;
+        for (int row = firstRow; row <= lastRow; ++row) {
+            swept |= a.rows[row];
+        }
+        
+        // Shift a's bits into b's column space and test the whole word at once
+        uint64_t aligned = dx >= 0 ? (swept >> dx) : (swept << -dx);
+        if (aligned & b.rows[y - by]) {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
 void TextureManager::draw(const std::string& id, int x, int y, int width, int height, 
                          SDL_Renderer* renderer, SDL_RendererFlip flip) {
     // Source and destination rectangles
@@ -56,7 +537,7 @@ void TextureManager::draw(const std::string& id, int x, int y, int width, int he
     SDL_Rect destRect = {x, y, width, height};
     
     // Render the texture
-    SDL_RenderCopyEx(renderer, textureMap[id], &srcRect, &destRect, 0, nullptr, flip);
+    copyTexture(renderer, useTexture(id, renderer), &srcRect, destRect, flip);
 }
 
 void TextureManager::drawWhole(const std::string& id, int x, int y, int width, int height, 
@@ -65,7 +546,7 @@ void TextureManager::drawWhole(const std::string& id, int x, int y, int width, i
     SDL_Rect destRect = {x, y, width, height};
     
     // Render the texture
-    SDL_RenderCopyEx(renderer, textureMap[id], NULL, &destRect, 0, nullptr, flip);
+    copyTexture(renderer, useTexture(id, renderer), NULL, destRect, flip);
 }
 
 void TextureManager::drawFrame(const std::string& id, int x, int y, int width, int height, 
@@ -82,25 +563,47 @@ void TextureManager::drawFrame(const std::string& id, int x, int y, int width, i
     SDL_Rect destRect = {x, y, width, height};
     
     // Render the specific frame
-    SDL_RenderCopyEx(renderer, textureMap[id], &srcRect, &destRect, 0, nullptr, flip);
+    copyTexture(renderer, useTexture(id, renderer), &srcRect, destRect, flip);
+}
+
+void TextureManager::drawFrame(const std::string& id, int frameWidth, int frameHeight, 
+                              int currentRow, int currentFrame, const SDL_Rect& destRect, 
+                              SDL_Renderer* renderer, SDL_RendererFlip flip) {
+    // Source rectangle keeps the sprite sheet frame size regardless of destination scale
+    SDL_Rect srcRect = {frameWidth * currentFrame, frameHeight * currentRow, frameWidth, frameHeight};
+    
+    // Render the specific frame
+    copyTexture(renderer, useTexture(id, renderer), &srcRect, destRect, flip);
+}
+
+void TextureManager::submit(const RenderCommand* commands, size_t count, SDL_Renderer* renderer) {
+    for (size_t i = 0; i < count; ++i) {
+        copyTexture(renderer, commands[i].texture, &commands[i].srcRect, commands[i].destRect, SDL_FLIP_NONE);
+    }
 }
 
 void TextureManager::drawPortion(const std::string& id, const SDL_Rect& srcRect, const SDL_Rect& destRect,
                                SDL_Renderer* renderer, SDL_RendererFlip flip) {
     // Render the specific portion of the texture
-    SDL_RenderCopyEx(renderer, textureMap[id], &srcRect, &destRect, 0, nullptr, flip);
+    copyTexture(renderer, useTexture(id, renderer), &srcRect, destRect, flip);
 }
 
 SDL_Texture* TextureManager::getTexture(const std::string& id) {
     // Return the texture if it exists
-    if (textureMap.find(id) != textureMap.end()) {
-        return textureMap[id];
+    auto it = textureMap.find(id);
+    if (it != textureMap.end()) {
+        return it->second;
     }
     
     std::cerr << "Texture with ID: " << id << " not found!" << std::endl;
     return nullptr;
 }
 
+SDL_Texture* TextureManager::findTexture(const std::string& id) const {
+    auto it = textureMap.find(id);
+    return it != textureMap.end() ? it->second : nullptr;
+}
+
 void TextureManager::clearTextures() {
     // Free all textures and clear the map
     for (auto& texture : textureMap) {
@@ -110,11 +613,16 @@ void TextureManager::clearTextures() {
     }
     
     textureMap.clear();
+    cpuImages.clear();
+    maskMap.clear();
+    records.clear();
+    residentBytes = 0;
 }
 
 void TextureManager::clean() {
     // Clean up all loaded textures
     clearTextures();
+    pack.close();
     
     // Clean up the instance
     delete instance;
@@ -3,9 +3,64 @@
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
+#include <SDL2/SDL_ttf.h>
 #include <string>
 #include <map>
+#include <vector>
+#include <functional>
+#include <cstdint>
 #include <iostream>
+#include <unordered_map>
+#include "assetpack.h"
+#include "constants.h"
+#include "rasterizer.h"
+
+// 1-bit alpha mask for one sprite-sheet frame. Each scanline is one 64-bit word
+// with bit x set when column x is solid, so frames may be at most 64 pixels wide.
+struct CollisionMask {
+    int width;
+    int height;
+    std::vector<uint64_t> rows;
+};
+
+// Image file to load as a texture; a non-zero frame size also builds collision masks
+struct TextureRequest {
+    std::string fileName;
+    std::string id;
+    int frameWidth;
+    int frameHeight;
+};
+
+// Called on the render thread after each texture is created, e.g. to draw a loading screen
+typedef std::function<void(int loaded, int total)> LoadProgressCallback;
+
+// How long one texture took to get ready
+struct TextureLoadTiming {
+    std::string id;
+    double decodeMs;        // Image decode on a worker thread
+    double uploadMs;        // Texture creation on the render thread
+};
+
+// Residency report for one known texture
+struct TextureResidency {
+    std::string id;
+    size_t bytes;           // Approximate memory held while resident
+    int refCount;
+    bool resident;
+};
+
+// One textured quad, built off the render thread and submitted on it
+struct RenderCommand {
+    SDL_Texture* texture;
+    SDL_Rect srcRect;
+    SDL_Rect destRect;
+};
+
+// Exact overlap test between two masks placed at (ax, ay) and (bx, by).
+// Mask a is also swept downward by sweepY pixels, covering every position
+// from ay to ay + sweepY.
+bool masksOverlap(const CollisionMask& a, int ax, int ay,
+                  const CollisionMask& b, int bx, int by, int sweepY = 0);
 
 class TextureManager {
 private:
@@ -15,6 +70,61 @@ private:
     // Map to store loaded textures
     std::map<std::string, SDL_Texture*> textureMap;
     
+    // Everything known about a texture, resident or not. Registered textures load on
+    // first use; unreferenced ones are evicted least-recently-used first when the
+    // resident total exceeds memoryBudget.
+    struct TextureRecord {
+        std::string fileName;
+        int frameWidth;
+        int frameHeight;
+        int refCount;
+        size_t bytes;           // 0 while not resident
+        uint64_t lastUsed;
+    };
+    std::map<std::string, TextureRecord> records;
+    size_t memoryBudget = static_cast<size_t>(TEXTURE_MEMORY_BUDGET_MB) * 1024 * 1024;
+    size_t residentBytes = 0;
+    uint64_t useClock = 0;
+    
+    // Resolve a texture for drawing, loading it if it is registered but not resident
+    SDL_Texture* useTexture(const std::string& id, SDL_Renderer* renderer);
+    // Record a newly created texture and evict others if over budget
+    void trackResident(const std::string& id, SDL_Texture* texture);
+    void evict(const std::string& id);
+    void enforceBudget(const std::string& keepId);
+    
+    // Collision masks per texture, frames stored row-major across the sprite sheet
+    struct SpriteMasks {
+        int framesPerRow;
+        std::vector<CollisionMask> frames;
+    };
+    std::map<std::string, SpriteMasks> maskMap;
+    
+    // Pre-decoded assets, preferred over files when present
+    AssetPack pack;
+    
+    // Premultiplied copies of textures for the CPU renderer, kept only when asked for.
+    // Draws go to the rasterizer while one is set, for textures that have a copy.
+    bool keepCpuImages = false;
+    std::unordered_map<SDL_Texture*, CpuImage> cpuImages;
+    SoftwareRasterizer* rasterizer = nullptr;
+    
+    void keepCpuImage(SDL_Texture* texture, SDL_Surface* surface);
+    // SDL_RenderCopyEx, or a rasterizer draw when the texture has a CPU copy
+    void copyTexture(SDL_Renderer* renderer, SDL_Texture* texture, const SDL_Rect* srcRect,
+                     const SDL_Rect& destRect, SDL_RendererFlip flip);
+    
+    // Create a texture straight from pixels in the mapped pack
+    bool createTextureFromPack(const PackEntry& entry, const std::string& id, SDL_Renderer* renderer,
+                               int frameWidth, int frameHeight);
+    
+    // Timings of the last loadTextures() call
+    std::vector<TextureLoadTiming> loadTimings;
+    double lastLoadTotalMs = 0.0;
+    
+    // Build per-frame alpha masks from a freshly loaded surface
+    void buildCollisionMasks(SDL_Surface* surface, const std::string& id, int frameWidth, int frameHeight);
+    
     // Private constructor for singleton
     TextureManager() = default;
     
@@ -29,8 +139,52 @@ public:
     // Initialize SDL_image
     bool init();
     
-    // Load texture from file
-    bool loadTexture(const std::string& fileName, const std::string& id, SDL_Renderer* renderer);
+    // Map an asset pack; later loads take images and fonts from it instead of decoding files
+    bool openPack(const std::string& fileName);
+    
+    // Open a font from the pack if it holds fileName, otherwise from disk
+    TTF_Font* openFont(const std::string& fileName, int pointSize);
+    
+    // Load texture from file; a non-zero frame size also builds per-frame collision masks
+    bool loadTexture(const std::string& fileName, const std::string& id, SDL_Renderer* renderer,
+                     int frameWidth = 0, int frameHeight = 0);
+    
+    // Remember where a texture comes from without loading it yet
+    void registerTexture(const TextureRequest& request);
+    
+    // Pin a texture, loading it now if needed; every acquire needs a matching release
+    bool acquire(const std::string& id, SDL_Renderer* renderer);
+    void release(const std::string& id);
+    
+    // Keep a CPU copy of every texture created from now on (roughly doubles texture memory)
+    void setKeepCpuImages(bool keep);
+    // Send draws to rasterizer until it is reset to nullptr
+    void setRasterizer(SoftwareRasterizer* target);
+    
+    // Memory allowed for resident textures; referenced textures are never evicted
+    void setMemoryBudget(size_t bytes);
+    size_t getMemoryBudget() const;
+    
+    // Residency reporting
+    size_t getTextureBytes(const std::string& id) const;
+    size_t getResidentBytes() const;
+    std::vector<TextureResidency> getResidency() const;
+    
+    // Load several textures. Images decode concurrently on the job system and each one is
+    // turned into a texture here as soon as it is ready; onProgress runs after every texture.
+    bool loadTextures(const std::vector<TextureRequest>& requests, SDL_Renderer* renderer,
+                      const LoadProgressCallback& onProgress = nullptr);
+    
+    // Per-texture and total timings of the last loadTextures() call
+    const std::vector<TextureLoadTiming>& getLoadTimings() const;
+    double getLastLoadTotalMs() const;
+    
+    // Decode an image file to a surface; safe to call from any thread
+    SDL_Surface* decodeImage(const std::string& fileName) const;
+    
+    // Create a texture from a decoded surface on the render thread; takes ownership of surface
+    bool createTexture(SDL_Surface* surface, const std::string& id, SDL_Renderer* renderer,
+                       int frameWidth = 0, int frameHeight = 0);
     
     // Draw texture (entire texture)
     void draw(const std::string& id, int x, int y, int width, int height, 
@@ -44,6 +198,14 @@ public:
                   int currentRow, int currentFrame, SDL_Renderer* renderer, 
                   SDL_RendererFlip flip = SDL_FLIP_NONE);
     
+    // Draw frame from sprite sheet into an arbitrary (possibly scaled) destination
+    void drawFrame(const std::string& id, int frameWidth, int frameHeight, 
+                  int currentRow, int currentFrame, const SDL_Rect& destRect, 
+                  SDL_Renderer* renderer, SDL_RendererFlip flip = SDL_FLIP_NONE);
+    
+    // Submit prebuilt render commands in order
+    void submit(const RenderCommand* commands, size_t count, SDL_Renderer* renderer);
+    
     // Draw portion of a texture (source rectangle)
     void drawPortion(const std::string& id, const SDL_Rect& srcRect, const SDL_Rect& destRect,
                     SDL_Renderer* renderer, SDL_RendererFlip flip = SDL_FLIP_NONE);
@@ -51,6 +213,12 @@ public:
     // Get texture by ID
     SDL_Texture* getTexture(const std::string& id);
     
+    // Look up a texture without logging; safe for concurrent readers
+    SDL_Texture* findTexture(const std::string& id) const;
+    
+    // Get the collision mask of a sprite-sheet frame, or nullptr if none was built
+    const CollisionMask* getCollisionMask(const std::string& id, int currentRow, int currentFrame) const;
+    
     // Clear all loaded textures
     void clearTextures();
     